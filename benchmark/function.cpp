@@ -0,0 +1,50 @@
+//
+// Copyright (c) 2019-2020 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <boost/ut.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr auto iterations = 1'000'000;
+
+template <class TFunction>
+auto steps() {
+  std::vector<TFunction> call_steps{};
+  auto size = std::size_t{};
+  for (auto i = 0; i < iterations; ++i) {
+    call_steps.emplace_back([&size, i](const std::string& step) {
+      size += step.size() + static_cast<std::size_t>(i);
+    });
+  }
+
+  const std::string step{"Given"};
+  for (auto& call : call_steps) {
+    call(step);
+  }
+  return size;
+}
+}  // namespace
+
+int main() {
+  using namespace boost::ut;
+
+#if defined(FUNCTION_UT)
+  "function_ut"_test = [] {
+    expect(steps<utility::function<void(const std::string&)>>() > 0_ul);
+  };
+#elif defined(FUNCTION_STD)
+  "function_std"_test = [] {
+    expect(steps<std::function<void(const std::string&)>>() > 0_ul);
+  };
+#elif defined(FUNCTION_MOVE_ONLY) and defined(__cpp_lib_move_only_function)
+  "function_move_only"_test = [] {
+    expect(steps<std::move_only_function<void(const std::string&)>>() > 0_ul);
+  };
+#endif
+}
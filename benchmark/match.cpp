@@ -0,0 +1,33 @@
+//
+// Copyright (c) 2019-2020 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <boost/ut.hpp>
+#include <string>
+#include <vector>
+
+int main() {
+  using namespace boost::ut;
+
+  static constexpr auto tests = 100'000;
+
+  "match"_test = [] {
+    std::vector<std::string> names{};
+    names.reserve(tests);
+    for (auto i = 0; i < tests; ++i) {
+      names.push_back("suite_" + std::to_string(i % 100) + ".aaaaaaaaaaaaaaaa" +
+                      "aaaaaaaaaaaaaaaa_" + std::to_string(i));
+    }
+
+    auto matches = 0;
+    for (const auto& name : names) {
+      matches += utility::is_match(name, "*a*a*a*a*a*a*a*a*b") ? 1 : 0;
+      matches += utility::is_match(name, "suite_?.*a*_*") ? 1 : 0;
+      matches += utility::is_match(name, "*_99999") ? 1 : 0;
+    }
+    expect(matches == 10'001_i);
+  };
+}
@@ -0,0 +1,40 @@
+//
+// Copyright (c) 2019-2020 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <boost/ut.hpp>
+#include <string_view>
+
+namespace {
+constexpr auto failures = 10'000;
+
+/// formats failed `eq_` on doubles the way the reporter does
+template <class TPrinter>
+auto print_failures() {
+  TPrinter printer{};
+  auto size = std::size_t{};
+  for (auto i = 0; i < failures; ++i) {
+    const auto lhs = i * 0.1;
+    printer << "\n  printer.cpp:" << i << ":FAILED [" << std::boolalpha
+            << boost::ut::eq(lhs, lhs + 1. / 3) << ']';
+    size += std::size(std::string_view{printer.view()});
+    printer.clear();
+  }
+  return size;
+}
+}  // namespace
+
+int main() {
+  using namespace boost::ut;
+
+#if defined(PRINTER_STREAM)
+  "printer_stream"_test = [] { expect(print_failures<printer>() > 0_ul); };
+#elif defined(PRINTER_FORMAT) and defined(BOOST_UT_HAS_FORMAT)
+  "printer_format"_test = [] {
+    expect(print_failures<format_printer>() > 0_ul);
+  };
+#endif
+}
@@ -4,6 +4,11 @@ module;
 #include <sys/wait.h>
 #include <unistd.h>
 #endif
+#if __has_include(<sys/mman.h>) and __has_include(<fcntl.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 export module boost.ut;
 export import std;
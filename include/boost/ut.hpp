@@ -72,18 +72,33 @@
 #if !defined(BOOST_UT_CXX_MODULES)
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
 #include <concepts>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <optional>
 #include <sstream>
 #include <stack>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -93,6 +108,11 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #endif
+#if __has_include(<sys/mman.h>) and __has_include(<fcntl.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #if defined(__cpp_exceptions)
 #include <exception>
 #endif
@@ -115,71 +135,129 @@ template <class>
 class function;
 template <class R, class... TArgs>
 class function<R(TArgs...)> {
+  static constexpr auto capacity = 3 * sizeof(void*);
+
+  template <class T>
+  static constexpr auto is_inline = sizeof(T) <= capacity and
+                                    alignof(T) <= alignof(void*) and
+                                    std::is_nothrow_move_constructible_v<T>;
+
  public:
   constexpr function() = default;
   template <class T>
-  constexpr /*explicit(false)*/ function(T data)
-      : invoke_{invoke_impl<T>},
-        destroy_{destroy_impl<T>},
-        data_{new T{static_cast<T&&>(data)}} {}
-  constexpr function(function&& other) noexcept
-      : invoke_{static_cast<decltype(other.invoke_)&&>(other.invoke_)},
-        destroy_{static_cast<decltype(other.destroy_)&&>(other.destroy_)},
-        data_{static_cast<decltype(other.data_)&&>(other.data_)} {
-    other.data_ = {};
+  constexpr /*explicit(false)*/ function(T data) : invoke_{invoke_impl<T>} {
+    if constexpr (is_inline<T>) {
+      ::new (static_cast<void*>(storage_.data())) T{static_cast<T&&>(data)};
+      if constexpr (not std::is_trivially_copyable_v<T>) {
+        manage_ = manage_impl<T>;
+      }
+    } else {  // the pointer itself is trivially relocatable
+      ::new (static_cast<void*>(storage_.data()))
+          T*{new T{static_cast<T&&>(data)}};
+      manage_ = manage_impl<T>;
+    }
   }
+  constexpr function(function&& other) noexcept { take(other); }
   constexpr function(const function&) = delete;
-  ~function() { destroy_(data_); }
+  ~function() { reset(); }
 
-  constexpr function& operator=(const function&) = delete;
-  constexpr function& operator=(function&&) = delete;
+  constexpr auto operator=(const function&) -> function& = delete;
+  constexpr auto operator=(function&& other) noexcept -> function& {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
   [[nodiscard]] constexpr auto operator()(TArgs... args) -> R {
-    return invoke_(data_, args...);
+    return invoke_(storage_.data(), args...);
   }
   [[nodiscard]] constexpr auto operator()(TArgs... args) const -> R {
-    return invoke_(data_, args...);
+    return invoke_(const_cast<std::byte*>(storage_.data()), args...);
   }
 
  private:
   template <class T>
-  [[nodiscard]] static auto invoke_impl(void* data, TArgs... args) -> R {
-    return (*static_cast<T*>(data))(args...);
+  [[nodiscard]] static auto get(void* storage) -> T* {
+    if constexpr (is_inline<T>) {
+      return std::launder(static_cast<T*>(storage));
+    } else {
+      return *std::launder(static_cast<T**>(storage));
+    }
   }
 
   template <class T>
-  static auto destroy_impl(void* data) -> void {
-    delete static_cast<T*>(data);
+  [[nodiscard]] static auto invoke_impl(void* storage, TArgs... args) -> R {
+    return (*get<T>(storage))(args...);
   }
 
-  R (*invoke_)(void*, TArgs...){};
-  void (*destroy_)(void*){};
-  void* data_{};
-};
-
-[[nodiscard]] inline auto is_match(std::string_view input,
-                                   std::string_view pattern) -> bool {
-  if (std::empty(pattern)) {
-    return std::empty(input);
+  /// Moves `from` into `to`, or destroys `from` if `to` is null.
+  /// Trivially copyable inline callables don't need it.
+  template <class T>
+  static auto manage_impl(void* to, void* from) -> void {
+    if constexpr (is_inline<T>) {
+      if (to) {
+        ::new (to) T{static_cast<T&&>(*get<T>(from))};
+      }
+      get<T>(from)->~T();
+    } else if (to) {
+      std::memcpy(to, from, sizeof(T*));
+    } else {
+      delete get<T>(from);
+    }
   }
 
-  if (std::empty(input)) {
-    return pattern[0] == '*' ? is_match(input, pattern.substr(1)) : false;
+  constexpr auto take(function& other) noexcept -> void {
+    if (other.manage_) {
+      other.manage_(storage_.data(), other.storage_.data());
+    } else {
+      storage_ = other.storage_;
+    }
+    invoke_ = std::exchange(other.invoke_, {});
+    manage_ = std::exchange(other.manage_, {});
   }
 
-  if (pattern[0] != '?' and pattern[0] != '*' and pattern[0] != input[0]) {
-    return false;
+  constexpr auto reset() noexcept -> void {
+    if (manage_) {
+      manage_(nullptr, storage_.data());
+    }
+    invoke_ = {};
+    manage_ = {};
   }
 
-  if (pattern[0] == '*') {
-    for (decltype(std::size(input)) i = 0u; i <= std::size(input); ++i) {
-      if (is_match(input.substr(i), pattern.substr(1))) {
-        return true;
-      }
+  R (*invoke_)(void*, TArgs...){};
+  void (*manage_)(void*, void*){};
+  alignas(void*) std::array<std::byte, capacity> storage_{};
+};
+
+[[nodiscard]] constexpr auto is_match(std::string_view input,
+                                      std::string_view pattern) -> bool {
+  using size_type = std::string_view::size_type;
+  size_type i{};
+  size_type p{};
+  auto star = std::string_view::npos;
+  size_type resume{};
+
+  while (i < std::size(input)) {
+    if (p < std::size(pattern) and
+        (pattern[p] == '?' or pattern[p] == input[i])) {
+      ++i;
+      ++p;
+    } else if (p < std::size(pattern) and pattern[p] == '*') {
+      star = p++;
+      resume = i;
+    } else if (star != std::string_view::npos) {  // let the last * eat one more
+      p = star + 1;
+      i = ++resume;
+    } else {
+      return false;
     }
-    return false;
   }
 
-  return is_match(input.substr(1), pattern.substr(1));
+  while (p < std::size(pattern) and pattern[p] == '*') {
+    ++p;
+  }
+  return p == std::size(pattern);
 }
 
 template <class TPattern, class TStr>
@@ -237,32 +315,235 @@ template <class T = std::string_view, class TDelim>
   }
   return output;
 }
-constexpr auto regex_match(const char* str, const char* pattern) -> bool {
-  if (*pattern == '\0' && *str == '\0') {
-    return true;
+/**
+ * Regular expression compiled to a Thompson NFA and matched without
+ * backtracking, in O(size(input) * size(pattern)).
+ * Supports literals, '.', '\\' escapes, grouping with '()', alternation
+ * with '|' and the '*', '+', '?' quantifiers. Matches the whole input.
+ * A quantifier with nothing to repeat, e.g. at the start of the pattern or
+ * right after '(' or '|', matches itself, like a leading '*' in POSIX
+ * basic regular expressions.
+ */
+class regex {
+ public:
+  constexpr regex() = default;
+  constexpr explicit regex(std::string_view pattern)
+      : program_{parser{.pattern = pattern}.parse_alternation()} {
+    program_.push_back({.op = kind::match});
+  }
+
+  /// the last pattern compiled by this thread, so that matching many inputs
+  /// against the same pattern compiles it once
+  [[nodiscard]] static auto cached(std::string_view pattern) -> const regex& {
+    thread_local std::pair<std::string, regex> last{{}, regex{{}}};
+    if (last.first != pattern) {
+      last = {std::string{pattern}, regex{pattern}};
+    }
+    return last.second;
   }
-  if (*pattern == '\0' && *str != '\0') {
-    return false;
+
+  [[nodiscard]] static constexpr auto is_special(char c) -> bool {
+    return std::string_view{".\\()|*+?"}.find(c) != std::string_view::npos;
   }
-  if (*str == '\0' && *pattern != '\0') {
+
+  [[nodiscard]] constexpr auto match(std::string_view input) const -> bool {
+    if (std::empty(program_)) {
+      return std::empty(input);
+    }
+    std::vector<std::size_t> current{};
+    std::vector<std::size_t> next{};
+    std::vector<std::size_t> pending{};
+    std::vector<std::size_t> added(std::size(program_), 0);
+    std::size_t step = 1;
+
+    // follows jumps and splits so that `threads` only holds consuming states
+    const auto add = [&](std::vector<std::size_t>& threads, std::size_t pc) {
+      pending.push_back(pc);
+      while (not std::empty(pending)) {
+        pc = pending.back();
+        pending.pop_back();
+        if (added[pc] == step) {
+          continue;
+        }
+        added[pc] = step;
+        const auto& inst = program_[pc];
+        if (inst.op == kind::jump) {
+          pending.push_back(pc + static_cast<std::size_t>(inst.x));
+        } else if (inst.op == kind::split) {
+          pending.push_back(pc + static_cast<std::size_t>(inst.y));
+          pending.push_back(pc + static_cast<std::size_t>(inst.x));
+        } else {
+          threads.push_back(pc);
+        }
+      }
+    };
+
+    add(current, 0);
+    for (const auto c : input) {
+      ++step;
+      next.clear();
+      for (const auto pc : current) {
+        const auto& inst = program_[pc];
+        if (inst.op == kind::any or
+            (inst.op == kind::literal and inst.c == c)) {
+          add(next, pc + 1);
+        }
+      }
+      std::swap(current, next);
+      if (std::empty(current)) {
+        return false;
+      }
+    }
+
+    for (const auto pc : current) {
+      if (program_[pc].op == kind::match) {
+        return true;
+      }
+    }
     return false;
   }
-  if (*pattern == '.') {
-    return regex_match(str + 1, pattern + 1);
+
+ private:
+  enum class kind : unsigned char { literal, any, split, jump, match };
+
+  /// jump/split targets are relative, so compiled fragments can be moved
+  struct instruction {
+    kind op{};
+    char c{};
+    std::ptrdiff_t x{};
+    std::ptrdiff_t y{};
+  };
+  using fragment = std::vector<instruction>;
+
+  static constexpr auto append(fragment& to, const fragment& from) -> void {
+    to.insert(to.end(), from.begin(), from.end());
   }
-  if (*pattern == *str) {
-    return regex_match(str + 1, pattern + 1);
+
+  struct parser {
+    [[nodiscard]] constexpr auto peek() const -> char {
+      return pos < std::size(pattern) ? pattern[pos] : '\0';
+    }
+    [[nodiscard]] constexpr auto done() const -> bool {
+      return pos >= std::size(pattern);
+    }
+
+    // alternation := concatenation ('|' concatenation)*
+    constexpr auto parse_alternation() -> fragment {
+      auto lhs = parse_concatenation();
+      while (not done() and peek() == '|') {
+        ++pos;
+        const auto rhs = parse_concatenation();
+        fragment code{{.op = kind::split, .x = 1, .y = std::ssize(lhs) + 2}};
+        append(code, lhs);
+        code.push_back({.op = kind::jump, .x = std::ssize(rhs) + 1});
+        append(code, rhs);
+        lhs = code;
+      }
+      return lhs;
+    }
+
+    // concatenation := repetition*
+    constexpr auto parse_concatenation() -> fragment {
+      fragment code{};
+      while (not done() and peek() != '|' and (peek() != ')' or not depth)) {
+        append(code, parse_repetition());
+      }
+      return code;
+    }
+
+    // repetition := atom ('*' | '+' | '?')*
+    constexpr auto parse_repetition() -> fragment {
+      auto atom = parse_atom();
+      while (not done() and
+             (peek() == '*' or peek() == '+' or peek() == '?')) {
+        const auto size = std::ssize(atom);
+        fragment code{};
+        switch (pattern[pos++]) {
+          case '*':
+            code.push_back({.op = kind::split, .x = 1, .y = size + 2});
+            append(code, atom);
+            code.push_back({.op = kind::jump, .x = -(size + 1)});
+            break;
+          case '+':
+            append(code, atom);
+            code.push_back({.op = kind::split, .x = -size, .y = 1});
+            break;
+          default:
+            code.push_back({.op = kind::split, .x = 1, .y = size + 1});
+            append(code, atom);
+            break;
+        }
+        atom = code;
+      }
+      return atom;
+    }
+
+    // atom := '(' alternation ')' | '.' | '\\' char | char
+    constexpr auto parse_atom() -> fragment {
+      const auto c = pattern[pos++];
+      if (c == '(') {
+        ++depth;
+        auto code = parse_alternation();
+        --depth;
+        if (not done()) {  // an unterminated group ends with the pattern
+          ++pos;
+        }
+        return code;
+      }
+      if (c == '.') {
+        return {{.op = kind::any}};
+      }
+      if (c == '\\' and not done()) {
+        return {{.op = kind::literal, .c = pattern[pos++]}};
+      }
+      return {{.op = kind::literal, .c = c}};
+    }
+
+    std::string_view pattern{};
+    std::size_t pos{};
+    std::size_t depth{};
+  };
+
+  fragment program_{};
+};
+
+constexpr auto regex_match(const char* str, const char* pattern) -> bool {
+  if (std::is_constant_evaluated()) {
+    return regex{pattern}.match(str);
   }
-  return false;
+  return regex::cached(pattern).match(str);
 }
 }  // namespace utility
 
 namespace reflection {
 #if defined(__cpp_lib_source_location) && !defined(_LIBCPP_APPLE_CLANG_VER)
-using source_location = std::source_location;
-#else
+/// what `source_location` aliased before it became ut's own type
+using std_source_location = std::source_location;
+#endif
+
+// N.B. ut's own type (before 2.3.1 an alias of std::source_location when
+// available) so that recorded events can be re-created from a file and line.
+// It converts implicitly from std::source_location and provides the same
+// accessors; locations re-created from a recording have no function/column.
 class source_location {
  public:
+  constexpr source_location() = default;
+  constexpr source_location(const char* file, int line) noexcept
+      : file_{file}, line_{line} {}
+
+#if defined(__cpp_lib_source_location) && !defined(_LIBCPP_APPLE_CLANG_VER)
+  constexpr /*explicit(false)*/ source_location(
+      const std::source_location& sl) noexcept
+      : file_{sl.file_name()},
+        function_{sl.function_name()},
+        line_{static_cast<int>(sl.line())},
+        column_{static_cast<int>(sl.column())} {}
+
+  [[nodiscard]] static constexpr auto current(
+      const std::source_location& sl = std::source_location::current()) noexcept {
+    return source_location{sl};
+  }
+#else
   [[nodiscard]] static constexpr auto current(
 #if (__has_builtin(__builtin_FILE) and __has_builtin(__builtin_LINE))
       const char* file = __builtin_FILE(), int line = __builtin_LINE()
@@ -270,19 +551,22 @@ class source_location {
       const char* file = "unknown", int line = {}
 #endif
           ) noexcept {
-    source_location sl{};
-    sl.file_ = file;
-    sl.line_ = line;
-    return sl;
+    return source_location{file, line};
   }
+#endif
   [[nodiscard]] constexpr auto file_name() const noexcept { return file_; }
+  [[nodiscard]] constexpr auto function_name() const noexcept {
+    return function_;
+  }
   [[nodiscard]] constexpr auto line() const noexcept { return line_; }
+  [[nodiscard]] constexpr auto column() const noexcept { return column_; }
 
  private:
   const char* file_{"unknown"};
+  const char* function_{""};
   int line_{};
+  int column_{};
 };
-#endif
 namespace detail {
 template <typename TargetType>
 [[nodiscard]] constexpr auto get_template_function_name_use_type()
@@ -571,6 +855,7 @@ struct test {
   std::string_view type{};
   std::string name{};  /// might be dynamic
   std::vector<std::string_view> tag{};
+  std::chrono::milliseconds timeout{};  /// 0: --timeout
   reflection::source_location location{};
   TArg arg{};
   Test run{};
@@ -639,6 +924,9 @@ struct assertion_pass {
 };
 template <class TExpr>
 assertion_pass(TExpr) -> assertion_pass<TExpr>;
+struct assertions_passed {  /// batch of passed assertions (counting only)
+  std::size_t count{};
+};
 template <class TExpr>
 struct assertion_fail {
   TExpr expr{};
@@ -661,6 +949,12 @@ struct exception {
   const char* msg{};
   [[nodiscard]] auto what() const -> const char* { return msg; }
 };
+struct repetitions {  /// of a top-level test (--repeat, --until-fail)
+  std::string_view name{};
+  std::size_t runs{};
+  std::size_t fails{};    /// runs which failed
+  bool repeatable{true};  /// false: not copyable, it was run once
+};
 struct summary {};
 }  // namespace events
 
@@ -676,13 +970,32 @@ struct fatal {
     return detail::fatal_{t, sl};
   }
 };
+struct clock {
+  using duration = std::chrono::steady_clock::duration;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<clock>;
+  static constexpr bool is_steady = true;
+
+  /// set while recorded events are replayed into a reporter, so that the
+  /// reporter observes the time at which the event originally happened
+  static inline thread_local std::optional<time_point> replayed{};
+
+  [[nodiscard]] static auto now() noexcept -> time_point {
+    if (replayed) {
+      return *replayed;
+    }
+    return time_point{std::chrono::steady_clock::now().time_since_epoch()};
+  }
+};
+
 struct cfg {
   using value_ref = std::variant<std::monostate, std::reference_wrapper<bool>,
                                  std::reference_wrapper<std::size_t>,
                                  std::reference_wrapper<std::string>>;
   using option = std::tuple<std::string, std::string, value_ref, std::string>;
-  static inline reflection::source_location location{};
-  static inline bool wip{};
+  static inline thread_local reflection::source_location location{};
+  static inline thread_local bool wip{};
 
 #if defined(_MSC_VER)
   static inline int largc = __argc;
@@ -696,6 +1009,7 @@ struct cfg {
   static inline std::string query_pattern;           // <- done
   static inline bool invert_query_pattern = false;   // <- done
   static inline std::string query_regex_pattern;     // <- done
+  static inline utility::regex query_regex{};
   static inline bool show_help = false;              // <- done
   static inline bool show_tests = false;             // <- done
   static inline bool list_tags = false;              // <- done
@@ -707,8 +1021,8 @@ struct cfg {
   static inline std::size_t abort_after_n_failures =
       std::numeric_limits<std::size_t>::max();  // <- done
   static inline bool show_duration = false;     // <- done
-  static inline std::size_t show_min_duration = 0;
-  static inline std::string input_filename;
+  static inline std::size_t show_min_duration = 0;  // <- done
+  static inline std::string input_filename;  // <- done
   static inline bool show_test_names = false;  // <- done
   static inline bool show_reporters = false;   // <- done
   static inline std::string sort_order = "decl";
@@ -716,6 +1030,22 @@ struct cfg {
   static inline std::string use_colour = "yes";  // <- done
   static inline bool show_lib_identity = false;  // <- done
   static inline std::string wait_for_keypress = "never";
+  static inline std::size_t jobs = 1;
+  static inline bool parallel_tests = false;
+  static inline std::size_t shard_index = 0;
+  static inline std::size_t shard_count = 0;  // 0: use GTEST_TOTAL_SHARDS
+  static inline std::size_t fork_jobs = 0;
+  static inline bool stream_junit = false;
+  static inline std::string replay_filename;
+  static inline std::size_t slowest_tests = 10;
+  static inline std::size_t timeout_ms = 0;  // 0: none
+  static inline std::size_t repeat = 1;
+  static inline bool until_fail = false;
+  static inline std::string cache_dir;
+  static inline std::string cache_key;  // empty: hash of the executable
+  static inline bool failed_first = false;
+  static inline bool only_failed = false;
+  static inline std::string durations_from;
 
   static inline const std::vector<option> options = {
       // clang-format off
@@ -730,7 +1060,7 @@ struct cfg {
   {"-a, --abort", "", std::ref(abort_early), "abort at first failure"},
   {"-x, --abortx", "<no. failures>", std::ref(abort_after_n_failures), "abort after x failures"},
   {"-d, --durations", "", std::ref(show_duration), "show test durations"},
-  {"-D, --min-duration", "<seconds>", std::ref(show_min_duration), "show test durations for [...]"},
+  {"-D, --min-duration", "<seconds>", std::ref(show_min_duration), "show durations of tests taking at least <seconds>"},
   {"-f, --input-file", "<filename>", std::ref(input_filename), "load test names to run from a file"},
   {"--list-test-names-only", "", std::ref(show_test_names), "list all/matching test cases names only"},
   {"--list-reporters", "", std::ref(show_reporters), "list all reporters"},
@@ -738,10 +1068,41 @@ struct cfg {
   {"--rng-seed", "<'time'|number>", std::ref(rnd_seed), "set a specific seed for random numbers"},
   {"--use-colour", "<yes|no>", std::ref(use_colour), "should output be colourised"},
   {"--libidentify", "", std::ref(show_lib_identity), "report name and version according to libidentify standard"},
-  {"--wait-for-keypress", "<never|start|exit|both>", std::ref(wait_for_keypress), "waits for a keypress before exiting"}
+  {"--wait-for-keypress", "<never|start|exit|both>", std::ref(wait_for_keypress), "waits for a keypress before exiting"},
+  {"-j, --jobs", "<no. threads>", std::ref(jobs), "run suites on N worker threads (0: all cores)"},
+  {"--parallel-tests", "", std::ref(parallel_tests), "run top-level tests, instead of suites, on --jobs threads"},
+  {"--shard-index", "<index>", std::ref(shard_index), "run only the tests of this shard (defaults to GTEST_SHARD_INDEX)"},
+  {"--shard-count", "<no. shards>", std::ref(shard_count), "number of shards (defaults to GTEST_TOTAL_SHARDS)"},
+  {"--fork-jobs", "<no. processes>", std::ref(fork_jobs), "run each top-level test in a child process, N at a time"},
+  {"--stream", "", std::ref(stream_junit), "write junit results as each suite ends instead of at exit"},
+  {"--replay", "<filename>", std::ref(replay_filename), "report the events of a binlog file instead of running tests"},
+  {"--slowest", "<no. tests>", std::ref(slowest_tests), "number of slowest tests listed with --durations (defaults to 10)"},
+  {"--timeout", "<ms>", std::ref(timeout_ms), "end the run when a top-level test takes longer than <ms>"},
+  {"--repeat", "<N>", std::ref(repeat), "run each top-level test N times (--jobs at a time) and report how often it failed"},
+  {"--until-fail", "", std::ref(until_fail), "repeat each top-level test until it fails (at most --repeat times, if given)"},
+  {"--cache-dir", "<directory>", std::ref(cache_dir), "keep the results and durations of the tests in this directory"},
+  {"--cache-key", "<key>", std::ref(cache_key), "results cached under this key (defaults to a hash of the executable)"},
+  {"--failed-first", "", std::ref(failed_first), "run the tests which failed in the cached run first"},
+  {"--only-failed", "", std::ref(only_failed), "run only the tests which failed in the cached run (and new ones)"},
+  {"--durations-from", "<filename>", std::ref(durations_from), "schedule and shard by the test durations of a junit report or binlog"}
       // clang-format on
   };
 
+  /// <index, count> of the shard to run
+  [[nodiscard]] static auto shard() -> std::pair<std::size_t, std::size_t> {
+    if (shard_count) {
+      return {shard_index, shard_count};
+    }
+    const auto env = [](const char* name) -> std::size_t {
+      const auto* value = std::getenv(name);
+      return value ? std::strtoull(value, nullptr, 10) : 0;
+    };
+    if (const auto count = env("GTEST_TOTAL_SHARDS"); count > 1) {
+      return {env("GTEST_SHARD_INDEX"), count};
+    }
+    return {0, 1};
+  }
+
   static std::optional<cfg::option> find_arg(std::string_view arg) {
     for (const auto& option : cfg::options) {
       if (std::get<0>(option).find(arg) != std::string::npos) {
@@ -829,6 +1190,12 @@ struct cfg {
         // parse size argument
         std::size_t last;
         std::string argument(argv[i]);
+        if (&std::get<std::reference_wrapper<std::size_t>>(var).get() ==
+                &rnd_seed and
+            argument == "time") {
+          rnd_seed = 0;
+          continue;
+        }
         auto val = static_cast<std::size_t>(std::stoull(argument, &last));
         if (last != argument.length()) {
           std::cerr << "cannot parse option of " << argv[i - 1] << " "
@@ -863,14 +1230,14 @@ struct cfg {
           query_regex_pattern += ".*";
         } else if (c == '?') {
           query_regex_pattern += '.';
-        } else if (c == '.') {
-          query_regex_pattern += "\\.";
-        } else if (c == '\\') {
-          query_regex_pattern += "\\\\";
+        } else if (utility::regex::is_special(c)) {
+          query_regex_pattern += '\\';
+          query_regex_pattern += c;
         } else {
           query_regex_pattern += c;
         }
       }
+      query_regex = utility::regex{query_regex_pattern};
     }
   }
 };
@@ -884,8 +1251,64 @@ template <class T>
   return t;
 }
 template <class T>
-[[nodiscard]] constexpr auto get(const T& t) {
-  return get_impl(t, 0);
+inline constexpr auto is_small_v = [] {
+  if constexpr (std::is_trivially_copyable_v<T> and not std::is_array_v<T>) {
+    return sizeof(T) <= 4 * sizeof(void*);
+  } else {
+    return false;
+  }
+}();
+
+template <class T>
+[[nodiscard]] constexpr auto get(const T& t) -> decltype(auto) {
+  using type = std::remove_cvref_t<decltype(get_impl(t, 0))>;
+  if constexpr (is_small_v<type>) {
+    return type(get_impl(t, 0));
+  } else {  // compared in place
+    return get_impl(t, 0);
+  }
+}
+
+/**
+ * Operand of a comparison.
+ * Small trivially copyable values are stored, anything else is referenced
+ * while the assertion is evaluated and only copied by `capture()`, which the
+ * operators call when the comparison fails.
+ */
+template <class T, bool = is_small_v<T>>
+struct operand {
+  constexpr /*explicit(false)*/ operand(const T& t) : value_{t} {}
+  [[nodiscard]] constexpr auto operator*() const -> const T& { return value_; }
+  constexpr auto capture() -> void {}
+
+  T value_;
+};
+
+template <class T>
+class operand<T, false> {
+ public:
+  constexpr /*explicit(false)*/ operand(const T& t) : ref_{&t} {}
+  [[nodiscard]] constexpr auto operator*() const -> const T& {
+    return copy_ ? *copy_ : *ref_;
+  }
+  constexpr auto capture() -> void {
+    if constexpr (std::is_copy_constructible_v<T>) {
+      if (not copy_) {
+        copy_.emplace(*ref_);
+      }
+    }
+  }
+
+ private:
+  const T* ref_{};
+  std::optional<T> copy_{};
+};
+
+template <class T>
+constexpr auto capture(T& t) -> void {
+  if constexpr (requires { t.capture(); }) {
+    t.capture();
+  }
 }
 
 template <class T>
@@ -922,7 +1345,7 @@ struct value : op {
 
   constexpr /*explicit(false)*/ value(const T& _value) : value_{_value} {}
   [[nodiscard]] constexpr explicit operator T() const { return value_; }
-  [[nodiscard]] constexpr decltype(auto) get() const { return value_; }
+  [[nodiscard]] constexpr decltype(auto) get() const { return (value_); }
 
   T value_{};
 };
@@ -930,7 +1353,7 @@ struct value : op {
 template <std::floating_point T>
 struct value<T> : op {
   using value_type = T;
-  static inline auto epsilon = T{};
+  static inline thread_local auto epsilon = T{};
 
   constexpr value(const T& _value, const T precision) : value_{_value} {
     epsilon = precision;
@@ -1014,15 +1437,28 @@ struct eq_ : op {
           } else {
             return get(lhs) == get(rhs);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs, class TEpsilon>
@@ -1040,17 +1476,30 @@ struct approx_ : op {
           } else {
             return math::abs_diff(get(lhs), get(rhs)) < get(epsilon);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
   [[nodiscard]] constexpr auto epsilon() const { return get(epsilon_); }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const TEpsilon epsilon_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  TEpsilon epsilon_{};
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1068,26 +1517,39 @@ struct neq_ : op {
                                    TLhs> and
                                type_traits::has_static_member_object_epsilon_v<
                                    TRhs>) {
-            return math::abs(get(lhs_) - get(rhs_)) >
+            return math::abs(get(lhs) - get(rhs)) >
                    math::min_value(TLhs::epsilon, TRhs::epsilon);
           } else if constexpr (type_traits::has_static_member_object_epsilon_v<
                                    TLhs>) {
-            return math::abs(get(lhs_) - get(rhs_)) > TLhs::epsilon;
+            return math::abs(get(lhs) - get(rhs)) > TLhs::epsilon;
           } else if constexpr (type_traits::has_static_member_object_epsilon_v<
                                    TRhs>) {
-            return math::abs(get(lhs_) - get(rhs_)) > TRhs::epsilon;
+            return math::abs(get(lhs) - get(rhs)) > TRhs::epsilon;
           } else {
-            return get(lhs_) != get(rhs_);
+            return get(lhs) != get(rhs);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1100,17 +1562,30 @@ struct gt_ : op {
                         type_traits::has_static_member_object_value_v<TRhs>) {
             return lhs.value > rhs.value;
           } else {
-            return get(lhs_) > get(rhs_);
+            return get(lhs) > get(rhs);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1123,17 +1598,30 @@ struct ge_ : op {
                         type_traits::has_static_member_object_value_v<TRhs>) {
             return lhs.value >= rhs.value;
           } else {
-            return get(lhs_) >= get(rhs_);
+            return get(lhs) >= get(rhs);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1152,19 +1640,31 @@ struct lt_ : op {
             return TLhs::value < TRhs::value;
 #endif
           } else {
-            return get(lhs_) < get(rhs_);
+            return get(lhs) < get(rhs);
           }
         }()} {
+    if (not value_) {
+      capture();
+    }
   }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
+
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
 
  private:
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1177,17 +1677,30 @@ struct le_ : op {
                         type_traits::has_static_member_object_value_v<TRhs>) {
             return lhs.value <= rhs.value;
           } else {
-            return get(lhs_) <= get(rhs_);
+            return get(lhs) <= get(rhs);
           }
-        }()} {}
+        }()} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(*lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(*rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    lhs_.capture();
+    rhs_.capture();
+  }
+
+  operand<TLhs> lhs_;
+  operand<TRhs> rhs_;
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1195,15 +1708,28 @@ struct and_ : op {
   constexpr and_(const TLhs& lhs = {}, const TRhs& rhs = {})
       : lhs_{lhs},
         rhs_{rhs},
-        value_{static_cast<bool>(lhs) and static_cast<bool>(rhs)} {}
+        value_{static_cast<bool>(lhs) and static_cast<bool>(rhs)} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    detail::capture(lhs_);
+    detail::capture(rhs_);
+  }
+
+  TLhs lhs_{};
+  TRhs rhs_{};
+  bool value_{};
 };
 
 template <class TLhs, class TRhs>
@@ -1211,27 +1737,46 @@ struct or_ : op {
   constexpr or_(const TLhs& lhs = {}, const TRhs& rhs = {})
       : lhs_{lhs},
         rhs_{rhs},
-        value_{static_cast<bool>(lhs) or static_cast<bool>(rhs)} {}
+        value_{static_cast<bool>(lhs) or static_cast<bool>(rhs)} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
-  [[nodiscard]] constexpr auto lhs() const { return get(lhs_); }
-  [[nodiscard]] constexpr auto rhs() const { return get(rhs_); }
+  [[nodiscard]] constexpr auto lhs() const -> decltype(auto) {
+    return get(lhs_);
+  }
+  [[nodiscard]] constexpr auto rhs() const -> decltype(auto) {
+    return get(rhs_);
+  }
 
-  const TLhs lhs_{};
-  const TRhs rhs_{};
-  const bool value_{};
+  constexpr auto capture() -> void {
+    detail::capture(lhs_);
+    detail::capture(rhs_);
+  }
+
+  TLhs lhs_{};
+  TRhs rhs_{};
+  bool value_{};
 };
 
 template <class T>
 struct not_ : op {
   explicit constexpr not_(const T& t = {})
-      : t_{t}, value_{not static_cast<bool>(t)} {}
+      : t_{t}, value_{not static_cast<bool>(t)} {
+    if (not value_) {
+      capture();
+    }
+  }
 
   [[nodiscard]] constexpr operator bool() const { return value_; }
   [[nodiscard]] constexpr auto value() const { return get(t_); }
 
-  const T t_{};
-  const bool value_{};
+  constexpr auto capture() -> void { detail::capture(t_); }
+
+  T t_{};
+  bool value_{};
 };
 
 template <class>
@@ -1336,35 +1881,140 @@ struct colors {
   std::string_view skip = "\033[33m";
 };
 
-class printer {
-  [[nodiscard]] auto color(const bool cond) {
-    return cond ? colors_.pass : colors_.fail;
-  }
-
+namespace detail {
+/// Output of `printer`, everything is written through std::ostringstream
+class stream_output {
  public:
-  printer() = default;
-  /*explicit(false)*/ printer(const colors colors) : colors_{colors} {}
-
   template <class T>
-  auto& operator<<(const T& t) {
-    out_ << detail::get(t);
+  auto operator<<(const T& t) -> stream_output& {
+    out_ << t;
     return *this;
   }
 
+  [[nodiscard]] auto str() const { return out_.str(); }
+  [[nodiscard]] auto view() const { return out_.view(); }
+  auto clear() -> void { out_.str({}); }
+
+ private:
+  std::ostringstream out_{};
+};
+
+#if defined(BOOST_UT_HAS_FORMAT)
+/// Output of `format_printer`, numbers are written with std::to_chars and
+/// other formattable values with std::format_to into a string which is
+/// reused. Only types which are just ostreamable, and stream manipulators,
+/// go through a (lazily created) std::ostringstream.
+class format_output {
+ public:
   template <class T>
-    requires std::ranges::range<T> && (!concepts::ostreamable<T>)
-  auto& operator<<(T&& t) {
-    *this << '{';
-    auto first = true;
-    for (const auto& arg : t) {
-      *this << (first ? "" : ", ") << arg;
-      first = false;
+  auto operator<<(const T& t) -> format_output& {
+    if constexpr (std::is_invocable_v<const T&, std::ios_base&>) {
+      stream() << t;  // manipulator, e.g. std::boolalpha
+    } else if constexpr (std::is_same_v<T, bool>) {
+      if (flags() & std::ios_base::boolalpha) {
+        out_ += t ? "true" : "false";
+      } else {
+        out_ += t ? '1' : '0';
+      }
+    } else if constexpr (std::is_same_v<T, char> or
+                         std::is_same_v<T, signed char> or
+                         std::is_same_v<T, unsigned char>) {
+      out_ += static_cast<char>(t);
+    } else if constexpr (std::is_floating_point_v<T> or
+                         (std::is_integral_v<T> and
+                          not std::is_same_v<T, wchar_t> and
+                          not std::is_same_v<T, char8_t> and
+                          not std::is_same_v<T, char16_t> and
+                          not std::is_same_v<T, char32_t>)) {
+      if (stream_ and ((flags() & ~std::ios_base::boolalpha) != default_flags or
+                       stream_->precision() != 6 or stream_->width() != 0)) {
+        fallback(t);
+        return *this;
+      }
+      std::array<char, 64> chars{};
+      const auto [last, ec] = [&] {
+        if constexpr (std::is_floating_point_v<T>) {  // as `%g`, like ostream
+          return std::to_chars(chars.data(), chars.data() + std::size(chars),
+                               t, std::chars_format::general, 6);
+        } else {
+          return std::to_chars(chars.data(), chars.data() + std::size(chars),
+                               t);
+        }
+      }();
+      out_.append(chars.data(), last);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+      out_ += std::string_view{t};
+    } else if constexpr (requires { std::formatter<T, char>{}; }) {
+      std::format_to(std::back_inserter(out_), "{}", t);
+    } else {
+      fallback(t);
     }
-    *this << '}';
     return *this;
   }
 
-  auto& operator<<(std::string_view sv) {
+  [[nodiscard]] auto str() const { return out_; }
+  [[nodiscard]] auto view() const -> std::string_view { return out_; }
+  auto clear() -> void { out_.clear(); }
+
+ private:
+  static constexpr auto default_flags = std::ios_base::skipws | std::ios_base::dec;
+
+  [[nodiscard]] auto flags() const {
+    return stream_ ? stream_->flags() : default_flags;
+  }
+
+  auto stream() -> std::ostringstream& {
+    if (not stream_) {
+      stream_.emplace();
+    }
+    return *stream_;
+  }
+
+  template <class T>
+  auto fallback(const T& t) -> void {
+    auto& os = stream();
+    os << t;
+    out_ += os.view();
+    os.str({});
+  }
+
+  std::string out_{};
+  std::optional<std::ostringstream> stream_{};
+};
+#endif
+}  // namespace detail
+
+template <class TOutput>
+class basic_printer {
+  [[nodiscard]] auto color(const bool cond) {
+    return cond ? colors_.pass : colors_.fail;
+  }
+
+ public:
+  basic_printer() = default;
+  /*explicit(false)*/ basic_printer(const colors colors) : colors_{colors} {}
+
+  template <class T>
+    requires(!std::ranges::range<T> || concepts::ostreamable<T>)
+  auto& operator<<(const T& t) {
+    out_ << detail::get(t);
+    return *this;
+  }
+
+  template <class T>
+    requires std::ranges::range<T> && (!concepts::ostreamable<T>)
+  auto& operator<<(T&& t) {
+    *this << '{';
+    auto first = true;
+    for (const auto& arg : t) {
+      *this << (first ? "" : ", ") << arg;
+      first = false;
+    }
+    *this << '}';
+    return *this;
+  }
+
+  auto& operator<<(std::string_view sv) {
     out_ << sv;
     return *this;
   }
@@ -1465,18 +2115,195 @@ class printer {
   }
 
   auto str() const { return out_.str(); }
+  auto view() const { return out_.view(); }
+  auto clear() { out_.clear(); }
   const auto& colors() const { return colors_; }
 
  private:
   ut::colors colors_{};
-  std::ostringstream out_{};
+  TOutput out_{};
+};
+
+class printer : public basic_printer<detail::stream_output> {
+ public:
+  using basic_printer::basic_printer;
+};
+
+#if defined(BOOST_UT_HAS_FORMAT)
+/// printer without iostreams for the common types (see `format_output`)
+class format_printer : public basic_printer<detail::format_output> {
+ public:
+  using basic_printer::basic_printer;
+};
+#endif
+
+namespace detail {
+/// Output kept until the end of the run. At most `capacity` bytes are held in
+/// memory, anything beyond that is spilled to an anonymous temporary file, so
+/// memory does not grow with the number of tests.
+class spill_buffer {
+ public:
+  explicit spill_buffer(const std::size_t capacity = 64 * 1024)
+      : capacity_{capacity} {}
+
+  auto append(std::string_view text) -> void {
+    if (std::size(data_) + std::size(text) > capacity_ and spill()) {
+      if (std::size(text) > capacity_) {
+        std::fwrite(text.data(), 1, std::size(text), file_.get());
+        return;
+      }
+    }
+    data_ += text;
+  }
+
+  /// writes the contents, spilled ones first, and clears them
+  auto write_to(std::ostream& os) -> void {
+    if (file_) {
+      std::rewind(file_.get());
+      std::array<char, 16 * 1024> chunk{};
+      for (std::size_t n{};
+           (n = std::fread(chunk.data(), 1, std::size(chunk), file_.get()));) {
+        os.write(chunk.data(), static_cast<std::streamsize>(n));
+      }
+    }
+    os.write(data_.data(), static_cast<std::streamsize>(std::size(data_)));
+    clear();
+  }
+
+  auto clear() -> void {
+    data_.clear();
+    file_.reset();
+  }
+
+  [[nodiscard]] auto empty() const -> bool {
+    return std::empty(data_) and not file_;
+  }
+
+ private:
+  struct close {
+    auto operator()(std::FILE* file) const -> void { std::fclose(file); }
+  };
+
+  /// moves the contents held in memory to the file, false if there is none
+  auto spill() -> bool {
+    if (not file_) {
+      file_.reset(std::tmpfile());
+    }
+    if (file_) {
+      std::fwrite(data_.data(), 1, std::size(data_), file_.get());
+      data_.clear();
+    }
+    return static_cast<bool>(file_);
+  }
+
+  std::size_t capacity_{};
+  std::string data_{};
+  std::unique_ptr<std::FILE, close> file_{};
+};
+
+/// Counts durations in fixed logarithmic buckets, four per power of two
+/// nanoseconds, so percentiles of any number of tests take 1 KiB and are
+/// accurate to within 12.5%
+class duration_histogram {
+ public:
+  auto add(const std::chrono::nanoseconds duration) -> void {
+    ++buckets_[index(static_cast<std::uint64_t>(
+        std::max(duration.count(), std::int64_t{})))];
+    ++count_;
+  }
+
+  /// the middle of the bucket holding the `p`th (0..1) duration
+  [[nodiscard]] auto percentile(const double p) const
+      -> std::chrono::nanoseconds {
+    const auto exact = p * static_cast<double>(count_);
+    auto rank = static_cast<std::uint64_t>(exact);
+    rank += (static_cast<double>(rank) < exact or rank == 0) ? 1 : 0;
+    std::uint64_t seen{};
+    for (std::size_t i = 0; i < std::size(buckets_); ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::chrono::nanoseconds{static_cast<std::int64_t>(value(i))};
+      }
+    }
+    return {};
+  }
+
+  [[nodiscard]] auto count() const -> std::uint64_t { return count_; }
+
+ private:
+  static constexpr std::size_t sub_buckets = 4;
+
+  /// below 4ns exact, above the octave followed by the next two bits
+  [[nodiscard]] static constexpr auto index(const std::uint64_t ns)
+      -> std::size_t {
+    if (ns < sub_buckets) {
+      return static_cast<std::size_t>(ns);
+    }
+    const auto octave = static_cast<std::size_t>(std::bit_width(ns)) - 1;
+    return octave * sub_buckets + ((ns >> (octave - 2)) & (sub_buckets - 1));
+  }
+
+  [[nodiscard]] static constexpr auto value(const std::size_t i)
+      -> std::uint64_t {
+    if (i < sub_buckets) {
+      return i;
+    }
+    const auto octave = i / sub_buckets;
+    const auto width = std::uint64_t{1} << (octave - 2);
+    return (sub_buckets + i % sub_buckets) * width + width / 2;
+  }
+
+  std::array<std::uint32_t, 64 * sub_buckets> buckets_{};
+  std::uint64_t count_{};
+};
+
+/// Outcomes of the repeated tests, listed by the summary instead of their
+/// reports.
+struct repetitions {
+  struct repeated {
+    std::string name{};
+    std::size_t runs{};
+    std::size_t fails{};
+    bool repeatable{};
+  };
+
+  auto on(const events::repetitions& event) -> void {
+    tests.push_back({.name = std::string{event.name},
+                     .runs = event.runs,
+                     .fails = event.fails,
+                     .repeatable = event.repeatable});
+  }
+
+  template <class TStream>
+  auto print(TStream& out) const -> void {
+    if (std::empty(tests)) {
+      return;
+    }
+    out << "\nRepetitions:";
+    for (const auto& test : tests) {
+      out << "\n  \"" << test.name << "\": ";
+      if (not test.repeatable) {
+        out << "not repeatable (not copyable), run once";
+        continue;
+      }
+      out << test.runs - test.fails << " passed, " << test.fails
+          << " failed (flakiness "
+          << static_cast<double>(test.fails) / static_cast<double>(test.runs)
+          << ')';
+    }
+    out << '\n';
+  }
+
+  std::vector<repeated> tests{};
 };
+}  // namespace detail
 
 template <class TPrinter = printer>
 class reporter {
  public:
-  constexpr auto operator=(TPrinter printer) {
+  auto operator=(TPrinter printer) {
     printer_ = static_cast<TPrinter&&>(printer);
+    output_.clear();
   }
 
   auto on(events::run_begin) -> void {}
@@ -1484,15 +2311,18 @@ class reporter {
   auto on(events::test_begin test_begin) -> void {
     printer_ << "Running \"" << test_begin.name << "\"...";
     fails_ = asserts_.fail;
+    buffer();
   }
 
   auto on(events::test_run test_run) -> void {
     printer_ << "\n \"" << test_run.name << "\"...";
+    buffer();
   }
 
   auto on(events::test_skip test_skip) -> void {
     printer_ << test_skip.name << "...SKIPPED\n";
     ++tests_.skip;
+    buffer();
   }
 
   auto on(events::test_end) -> void {
@@ -1506,11 +2336,13 @@ class reporter {
       printer_ << printer_.colors().pass << "PASSED" << printer_.colors().none
                << '\n';
     }
+    buffer();
   }
 
   template <class TMsg>
   auto on(events::log<TMsg> l) -> void {
     printer_ << l.msg;
+    buffer();
   }
 
   auto on(events::exception exception) -> void {
@@ -1518,6 +2350,7 @@ class reporter {
              << "Unexpected exception with message:\n"
              << exception.what() << printer_.colors().none;
     ++asserts_.fail;
+    buffer();
   }
 
   template <class TExpr>
@@ -1525,6 +2358,10 @@ class reporter {
     ++asserts_.pass;
   }
 
+  auto on(events::assertions_passed passed) -> void {
+    asserts_.pass += passed.count;
+  }
+
   template <class TExpr>
   auto on(events::assertion_fail<TExpr> assertion) -> void {
     constexpr auto short_name = [](std::string_view name) {
@@ -1537,10 +2374,15 @@ class reporter {
              << "FAILED" << printer_.colors().none << " [" << std::boolalpha
              << assertion.expr << printer_.colors().none << ']';
     ++asserts_.fail;
+    buffer();
   }
 
   auto on(const events::fatal_assertion&) -> void {}
 
+  auto on(const events::repetitions& repetitions) -> void {
+    repeated_.on(repetitions);
+  }
+
   auto on(events::summary) -> void {
     if (tests_.fail or asserts_.fail) {
       printer_ << "\n========================================================"
@@ -1552,7 +2394,14 @@ class reporter {
                << asserts_.pass << " passed"
                << " | " << printer_.colors().fail << asserts_.fail << " failed"
                << printer_.colors().none << '\n';
-      std::cerr << printer_.str() << std::endl;
+      repeated_.print(printer_);
+      if constexpr (requires { printer_.clear(); }) {
+        buffer();
+        output_.write_to(std::cerr);
+        std::cerr << std::endl;
+      } else {
+        std::cerr << printer_.str() << std::endl;
+      }
     } else {
       std::cout << printer_.colors().pass << "All tests passed"
                 << printer_.colors().none << " (" << asserts_.pass
@@ -1561,6 +2410,7 @@ class reporter {
       if (tests_.skip) {
         std::cout << tests_.skip << " tests skipped\n";
       }
+      repeated_.print(std::cout);
 
       std::cout.flush();
     }
@@ -1580,393 +2430,2383 @@ class reporter {
 
   std::size_t fails_{};
 
+  detail::repetitions repeated_{};
+
   TPrinter printer_{};
-};
 
-template <class TPrinter = printer>
-class reporter_junit {
-  using clock_ref = std::chrono::high_resolution_clock;
-  using timePoint = std::chrono::time_point<clock_ref>;
-  using timeDiff = std::chrono::milliseconds;
-  enum class ReportType : std::uint8_t { CONSOLE, JUNIT } report_type_;
-  static constexpr ReportType CONSOLE = ReportType::CONSOLE;
-  static constexpr ReportType JUNIT = ReportType::JUNIT;
-  enum class StatusType : std::uint8_t { UNDEFINED, PASSED, FAILED, SKIPPED };
-  static constexpr StatusType UNDEFINED = StatusType::UNDEFINED;
-  static constexpr StatusType PASSED = StatusType::PASSED;
-  static constexpr StatusType FAILED = StatusType::FAILED;
-  static constexpr StatusType SKIPPED = StatusType::SKIPPED;
-  inline static const std::string statusStrings[] = { "UNDEFINED", "FAILED", "SKIPPED", "PASSED" };
+  /// what has been printed, written out by the summary if anything failed
+  detail::spill_buffer output_{};
 
-  struct test_result {
-    std::string test_name;
-    test_result* parent = nullptr;
-    StatusType status = UNDEFINED;
-    timePoint run_start = clock_ref::now();
-    timePoint run_stop = clock_ref::now();
-    std::size_t n_tests = 0LU;
-    std::size_t fail_tests = 0LU;
-    std::size_t assertions = 0LU;
-    std::size_t skipped = 0LU;
-    std::size_t fails = 0LU;
-    std::string report_string{};
-    std::vector<std::unique_ptr<test_result>> children;
+  /// moves what has been printed into the output, so that the printer only
+  /// holds the text of one event
+  auto buffer() -> void {
+    if constexpr (requires { printer_.clear(); }) {
+      output_.append(printer_.view());
+      printer_.clear();
+    }
+  }
+};
 
-    explicit test_result(std::string name, test_result* p = nullptr)
-        : test_name(std::move(name)), parent(p) {}
-    test_result(const test_result&) = delete;
-    test_result& operator=(const test_result&) = delete;
-    test_result(test_result&&) noexcept = default;
-    test_result& operator=(test_result&&) noexcept = default;
-    test_result& add_child(std::string name) {
-      children.emplace_back(std::make_unique<test_result>(std::move(name), this));
-      return *children.back();
+namespace detail {
+/// Text written into XML attributes or character data, the five special
+/// characters become entities whereas ANSI escape sequences and control
+/// bytes (not allowed by XML 1.0) are dropped. Everything in between is
+/// written through as is, without building an escaped copy.
+struct xml_escaped {
+  std::string_view text{};
+
+  static constexpr auto special = [] {
+    std::array<bool, 256> table{};
+    for (auto c = 0; c < 0x20; ++c) {
+      table[static_cast<std::size_t>(c)] = c != '\t' and c != '\n' and c != '\r';
     }
-  };
-  inline static int layer_ = 0;
-  colors color_{};
-  std::vector<std::unique_ptr<test_result>> suites_results_;
-  test_result* current_node_ = nullptr;
+    for (const auto c : std::string_view{"<>&\"'"}) {
+      table[static_cast<unsigned char>(c)] = true;
+    }
+    return table;
+  }();
+
+  friend auto operator<<(std::ostream& os, const xml_escaped& xml)
+      -> std::ostream& {
+    const auto* begin = xml.text.data();
+    const auto* const end = begin + xml.text.size();
+    while (begin != end) {
+      const auto* it = std::find_if(begin, end, [](const char c) {
+        return special[static_cast<unsigned char>(c)];
+      });
+      os.write(begin, it - begin);
+      if (it == end) {
+        break;
+      }
+      switch (*it) {
+        case '<': os << "&lt;"; break;
+        case '>': os << "&gt;"; break;
+        case '&': os << "&amp;"; break;
+        case '"': os << "&quot;"; break;
+        case '\'': os << "&apos;"; break;
+        case '\033':  // CSI: ESC '[' parameters... final byte in [@, ~]
+          if (it + 1 != end and it[1] == '[') {
+            for (it += 2; it != end and (*it < '@' or *it > '~'); ++it) {
+            }
+            if (it == end) {
+              return os;
+            }
+          }
+          break;
+        default: break;
+      }
+      begin = it + 1;
+    }
+    return os;
+  }
+};
 
-  std::streambuf* cout_save = std::cout.rdbuf();
-  std::ostream lcout_;
-  TPrinter printer_;
-  std::stringstream ss_out_{};
+/// A duration written in seconds with microsecond digits, never in the
+/// scientific notation which JUnit consumers reject
+struct fixed_seconds {
+  std::chrono::nanoseconds duration{};
 
-  void reset_printer() {
-    ss_out_.str("");
-    ss_out_.clear();
+  friend auto operator<<(std::ostream& os, const fixed_seconds& value)
+      -> std::ostream& {
+    std::array<char, 32> text{};
+    const auto seconds =
+        std::chrono::duration<double>{value.duration}.count();
+    const auto [end, ec] = std::to_chars(text.data(), text.data() + std::size(text),
+                                         seconds, std::chars_format::fixed, 6);
+    return os.write(text.data(), ec == std::errc{} ? end - text.data() : 0);
   }
+};
 
-  void add_node(std::string node_name) {
-    if (current_node_->parent == nullptr) {
-      reset_printer();
+/// Appends `text` as a JSON string literal (which is valid YAML as well),
+/// the runs in between characters to escape are appended as they are.
+inline auto append_quoted(std::string& out, std::string_view text) -> void {
+  out += '"';
+  for (auto it = text.begin(); it != text.end();) {
+    const auto special = std::find_if(it, text.end(), [](const char c) {
+      return c == '"' or c == '\\' or static_cast<unsigned char>(c) < 0x20;
+    });
+    out.append(it, special);
+    if (special == text.end()) {
+      break;
     }
-    layer_++;
-    current_node_ = &current_node_->add_child(node_name);
-  }
-
-  void count_result() {
-    current_node_->run_stop = clock_ref::now();
-    current_node_->status =
-        current_node_->fails > 0
-        ? FAILED : (current_node_->skipped ? SKIPPED : PASSED);
-    auto parent = current_node_->parent;
-    if (parent != nullptr) {
-      parent->n_tests += 1LU;
-      if ((current_node_->fails > 0 || current_node_->fail_tests > 0)) {
-        parent->fail_tests++;
+    switch (*special) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      default: {
+        constexpr std::string_view hex = "0123456789abcdef";
+        const auto c = static_cast<unsigned char>(*special);
+        out += "\\u00";
+        out += hex[c >> 4];
+        out += hex[c & 0xf];
       }
-      parent->assertions += current_node_->assertions;
-      parent->skipped += current_node_->skipped;
-      parent->fails += current_node_->fails;
     }
-    current_node_ = parent;
-    layer_--;
+    it = special + 1;
   }
+  out += '"';
+}
 
-  inline std::string getLeadingSpace() {
-    return layer_ > 0 ? "\n" + std::string(2 * (layer_ - 1), ' ')
-                      : "\n";
+/// failed assertion re-created from a recording (printed as recorded)
+struct formatted_expr {
+  std::string_view text{};
+  [[nodiscard]] constexpr explicit operator bool() const { return false; }
+  [[nodiscard]] constexpr auto get() const { return text; }
+
+  template <class TOStream>
+  friend auto operator<<(TOStream& os, const formatted_expr& expr)
+      -> TOStream& {
+    return static_cast<TOStream&>(os << expr.text);
   }
+};
 
+/// Compact, append-only encoding of reporter events.
+/// Every record is `[u32 size][u8 kind][i64 timestamp][payload]` where strings
+/// are length-prefixed (and null-terminated), so that events can be buffered
+/// while tests are running and replayed, in order, into a reporter afterwards.
+/// The same encoding is written to disk by `--reporter binlog`, records are
+/// self-contained so concatenated files (i.e. shards) replay as one run.
+class recording {
  public:
-  constexpr auto operator=(TPrinter printer) {
-    printer_ = static_cast<TPrinter&&>(printer);
+  enum class kind : std::uint8_t {
+    suite_begin,
+    suite_end,
+    test_begin,
+    test_run,
+    test_skip,
+    test_finish,
+    test_end,
+    assertion_pass,
+    assertion_fail,
+    fatal_assertion,
+    exception,
+    log,
+    repetitions
+  };
+
+  auto on(const events::suite_begin& event) -> void {
+    write(kind::suite_begin, event.type, event.name);
   }
-  reporter_junit() : lcout_(std::cout.rdbuf()) {
-    suites_results_.emplace_back(std::make_unique<test_result>("global"));
-    current_node_ = suites_results_.front().get();
+  auto on(const events::suite_end& event) -> void {
+    write(kind::suite_end, event.type, event.name);
+  }
+  auto on(const events::test_begin& event) -> void {
+    write(kind::test_begin, event.type, event.name, event.location);
+  }
+  auto on(const events::test_run& event) -> void {
+    write(kind::test_run, event.type, event.name);
+  }
+  auto on(const events::test_skip& event) -> void {
+    write(kind::test_skip, event.type, event.name);
+  }
+  auto on(const events::test_finish& event) -> void {
+    write(kind::test_finish, event.type, event.name);
+  }
+  auto on(const events::test_end& event) -> void {
+    write(kind::test_end, event.type, event.name);
   }
-  ~reporter_junit() { std::cout.rdbuf(cout_save); }
 
-  auto on(events::run_begin run) {
-    ::boost::ut::detail::cfg::parse_arg_with_fallback(run.argc, run.argv);
+  template <class TExpr>
+  auto on(const events::assertion_pass<TExpr>& event) -> void {
+    pass(1, event.location);
+  }
 
-    if (detail::cfg::show_reporters) {
-      std::cout << "available reporter:\n";
-      std::cout << "  console (default)\n";
-      std::cout << "  junit" << std::endl;
-      std::exit(0);
-    }
-    if (detail::cfg::use_reporter.starts_with("junit")) {
-      report_type_ = JUNIT;
-    } else {
-      report_type_ = CONSOLE;
-    }
-    if (!detail::cfg::use_colour.starts_with("yes")) {
-      color_ = {"", "", "", ""};
-    }
-    if (!detail::cfg::show_tests && !detail::cfg::show_test_names) {
-      std::cout.rdbuf(ss_out_.rdbuf());
-    }
+  auto on(const events::assertions_passed& event) -> void {
+    pass(event.count, {});
   }
 
-  auto on(events::suite_begin suite) -> void {
-    suites_results_.emplace_back(std::make_unique<test_result>((std::string)suite.name));
-    current_node_ = suites_results_.back().get();
+  template <class TExpr>
+  auto on(const events::assertion_fail<TExpr>& event) -> void {
+    write(kind::assertion_fail, event.location, format(event.expr));
   }
 
-  auto on(events::suite_end) -> void {
-    current_node_ = suites_results_.front().get();
+  auto on(const events::fatal_assertion&) -> void {
+    write(kind::fatal_assertion);
   }
 
-  auto on(events::test_begin test_event) -> void {  // starts outermost test
-    add_node((std::string)test_event.name);
-    if (report_type_ == CONSOLE) {
-      ss_out_ << getLeadingSpace();
-      ss_out_ << "Running " << test_event.type << " \"" << test_event.name
-              << "\"... ";
-    }
+  auto on(const events::exception& event) -> void {
+    write(kind::exception, std::string_view{event.what()});
   }
 
-  auto on(events::test_end test_event) -> void {
-    current_node_->report_string += ss_out_.str();
-    if (report_type_ == CONSOLE) {
-      if (current_node_->fails > 0) {
-        lcout_ << ss_out_.str();
-      }
-      else if (detail::cfg::show_successful_tests) {
-        if (!current_node_->children.empty()) {
-          ss_out_ << getLeadingSpace();
-          ss_out_ << "Running test \"" << test_event.name << "\" ... ";
-        }
-        ss_out_ << color_.pass << "PASSED " << color_.none;
-        print_duration(ss_out_);
-        lcout_ << ss_out_.str();
-      }
+  template <class TMsg>
+  auto on(const events::log<TMsg>& event) -> void {
+    if constexpr (std::is_convertible_v<const TMsg&, std::string_view>) {
+      write(kind::log, std::string_view{event.msg});
+    } else {
+      write(kind::log, format(event.msg));
     }
-    reset_printer();
-    count_result();
   }
 
-  auto on(events::test_run test_event) -> void {  // starts nested test
-    on(events::test_begin{.type = test_event.type, .name = test_event.name});
+  auto on(const events::repetitions& event) -> void {
+    write(kind::repetitions, event.name, std::uint64_t{event.runs},
+          std::uint64_t{event.fails}, event.repeatable);
   }
 
-  auto on(events::test_finish test_event) -> void {  // finishes nested test
-    on(events::test_end{.type = test_event.type, .name = test_event.name});
+  /// expressions and messages are recorded as text
+  template <class T>
+  [[nodiscard]] static auto format(const T& t) -> std::string {
+    printer printer{detail::cfg::use_colour.starts_with("yes")
+                        ? colors{}
+                        : colors{.none = "", .pass = "", .fail = "", .skip = ""}};
+    printer << std::boolalpha << t;
+    return printer.str();
   }
 
-  auto on(events::test_skip test_event) -> void {
-    ss_out_.clear();
-    add_node((std::string)test_event.name);
-    current_node_->status = SKIPPED;
-    current_node_->skipped += 1;
-    if (report_type_ == CONSOLE) {
-      lcout_ << getLeadingSpace();
-      lcout_ << "Running \"" << test_event.name << "\"... ";
-      lcout_ << color_.skip << "SKIPPED" << color_.none;
+  [[nodiscard]] auto data() const -> std::string_view { return data_; }
+  [[nodiscard]] auto empty() const -> bool { return std::empty(data_); }
+  auto clear() -> void {
+    data_.clear();
+    pass_ = npos;
+  }
+
+  template <class TReporter>
+  auto replay(TReporter& reporter) const -> void {
+    replay(data_, reporter);
+  }
+
+  /// summary of a, possibly truncated, recording
+  struct stats {
+    std::size_t depth{};  /// tests which have begun but not finished
+    std::size_t fails{};  /// failed assertions and exceptions
+    std::optional<std::size_t> fatal{};  /// offset of the fatal assertion
+  };
+
+  [[nodiscard]] static auto scan(std::string_view data) -> stats {
+    stats stats{};
+    for (reader in{data}; const auto size = in.available(); in.pos += size) {
+      switch (in.data[in.pos + sizeof(std::uint32_t)]) {
+        case static_cast<char>(kind::test_begin):
+        case static_cast<char>(kind::test_run):
+          ++stats.depth;
+          break;
+        case static_cast<char>(kind::test_finish):
+        case static_cast<char>(kind::test_end):
+          --stats.depth;
+          break;
+        case static_cast<char>(kind::assertion_fail):
+        case static_cast<char>(kind::exception):
+          ++stats.fails;
+          break;
+        case static_cast<char>(kind::fatal_assertion):
+          stats.fatal = in.pos;
+          break;
+        default:
+          break;
+      }
     }
-    reset_printer();
-    count_result();
+    return stats;
+  }
+
+  template <class TReporter>
+  static auto replay(std::string_view data, TReporter& reporter) -> void {
+    for (reader in{data}; const auto size = in.available();) {
+      const auto next = in.pos + size;
+      in.pos += sizeof(std::uint32_t);
+      const auto type = in.get<kind>();
+      clock::replayed =
+          clock::time_point{clock::duration{in.get<std::int64_t>()}};
+      switch (type) {
+        case kind::suite_begin:
+          emit(reporter, events::suite_begin{.type = in.str(), .name = in.str()});
+          break;
+        case kind::suite_end:
+          emit(reporter, events::suite_end{.type = in.str(), .name = in.str()});
+          break;
+        case kind::test_begin:
+          emit(reporter, events::test_begin{.type = in.str(),
+                                            .name = in.str(),
+                                            .location = in.location()});
+          break;
+        case kind::test_run:
+          emit(reporter, events::test_run{.type = in.str(), .name = in.str()});
+          break;
+        case kind::test_skip:
+          emit(reporter, events::test_skip{.type = in.str(), .name = in.str()});
+          break;
+        case kind::test_finish:
+          emit(reporter, events::test_finish{.type = in.str(), .name = in.str()});
+          break;
+        case kind::test_end:
+          emit(reporter, events::test_end{.type = in.str(), .name = in.str()});
+          break;
+        case kind::assertion_pass: {
+          const auto count = in.get<std::uint64_t>();
+          const auto location = in.location();
+          if constexpr (requires {
+                          reporter.on(events::assertions_passed{});
+                        }) {
+            reporter.on(events::assertions_passed{
+                .count = static_cast<std::size_t>(count)});
+          } else {
+            for (std::uint64_t i{}; i < count; ++i) {
+              emit(reporter, events::assertion_pass<bool>{
+                                 .expr = true, .location = location});
+            }
+          }
+          break;
+        }
+        case kind::assertion_fail: {
+          const auto location = in.location();
+          emit(reporter, events::assertion_fail<formatted_expr>{
+                             .expr = {.text = in.str()}, .location = location});
+          break;
+        }
+        case kind::fatal_assertion:
+          emit(reporter, events::fatal_assertion{});
+          break;
+        case kind::exception:
+          emit(reporter, events::exception{.msg = in.str().data()});
+          break;
+        case kind::log:
+          emit(reporter, events::log<std::string_view>{.msg = in.str()});
+          break;
+        case kind::repetitions:
+          emit(reporter, events::repetitions{
+                             .name = in.str(),
+                             .runs = static_cast<std::size_t>(in.get<std::uint64_t>()),
+                             .fails = static_cast<std::size_t>(in.get<std::uint64_t>()),
+                             .repeatable = in.get<bool>()});
+          break;
+      }
+      in.pos = next;
+    }
+    clock::replayed.reset();
+  }
+
+ private:
+  static constexpr auto npos = std::string::npos;
+  static constexpr auto header_size = sizeof(std::uint32_t) +
+                                      sizeof(kind) + sizeof(std::int64_t);
+
+  /// reporters are free to handle only a subset of events
+  template <class TReporter, class TEvent>
+  static auto emit(TReporter& reporter, const TEvent& event) -> void {
+    if constexpr (requires { reporter.on(event); }) {
+      reporter.on(event);
+    }
+  }
+
+  struct reader {
+    std::string_view data{};
+    std::size_t pos{};
+
+    /// size of the next record or 0 if there is no complete one left
+    [[nodiscard]] auto available() const -> std::uint32_t {
+      if (std::size(data) - pos < header_size) {
+        return 0;
+      }
+      std::uint32_t size{};
+      std::memcpy(&size, data.data() + pos, sizeof(size));
+      return size <= std::size(data) - pos ? size : 0;
+    }
+
+    template <class T>
+    [[nodiscard]] auto get() -> T {
+      T t{};
+      std::memcpy(&t, data.data() + pos, sizeof(T));
+      pos += sizeof(T);
+      return t;
+    }
+
+    [[nodiscard]] auto str() -> std::string_view {
+      const auto size = get<std::uint32_t>();
+      const auto str = data.substr(pos, size);
+      pos += size + 1;  // '\0'
+      return str;
+    }
+
+    [[nodiscard]] auto location() -> reflection::source_location {
+      const auto file = str();
+      return {file.data(), get<std::int32_t>()};
+    }
+  };
+
+  template <class T>
+    requires std::is_arithmetic_v<T> or std::is_enum_v<T>
+  auto put(const T t) -> void {
+    data_.append(reinterpret_cast<const char*>(&t), sizeof(t));
+  }
+
+  auto put(std::string_view str) -> void {
+    put(static_cast<std::uint32_t>(std::size(str)));
+    data_.append(str);
+    data_.push_back('\0');
+  }
+
+  auto put(const reflection::source_location& location) -> void {
+    put(std::string_view{location.file_name()});
+    put(static_cast<std::int32_t>(location.line()));
+  }
+
+  auto pass(const std::uint64_t count,
+            const reflection::source_location& location) -> void {
+    if (pass_ != npos) {  // consecutive passes are folded into one record
+      std::uint64_t total{};
+      std::memcpy(&total, data_.data() + pass_, sizeof(total));
+      total += count;
+      std::memcpy(data_.data() + pass_, &total, sizeof(total));
+      return;
+    }
+    write(kind::assertion_pass, count, location);
+    pass_ = last_ + header_size;
+  }
+
+  template <class... Ts>
+  auto write(const kind type, const Ts&... fields) -> void {
+    pass_ = npos;
+    last_ = std::size(data_);
+    put(std::uint32_t{});
+    put(type);
+    put(std::int64_t{clock::now().time_since_epoch().count()});
+    (put(fields), ...);
+    const auto size = static_cast<std::uint32_t>(std::size(data_) - last_);
+    std::memcpy(data_.data() + last_, &size, sizeof(size));
+  }
+
+  std::string data_{};
+  std::size_t last_{};
+  std::size_t pass_{npos};
+};
+
+/// Read-only contents of a file, memory-mapped where supported
+class mapped_file {
+ public:
+  explicit mapped_file(const std::string& filename) {
+#if __has_include(<sys/mman.h>) and __has_include(<fcntl.h>)
+    if (const auto fd = ::open(filename.c_str(), O_RDONLY); fd >= 0) {
+      struct stat st{};
+      if (::fstat(fd, &st) == 0 and st.st_size > 0) {
+        const auto size = static_cast<std::size_t>(st.st_size);
+        if (auto* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            addr != MAP_FAILED) {
+          data_ = {static_cast<const char*>(addr), size};
+        }
+      }
+      ::close(fd);
+      if (not std::empty(data_)) {
+        return;
+      }
+    }
+#endif
+    std::ifstream file{filename, std::ios::binary};
+    copy_.assign(std::istreambuf_iterator<char>{file}, {});
+    data_ = copy_;
+  }
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  ~mapped_file() {
+#if __has_include(<sys/mman.h>) and __has_include(<fcntl.h>)
+    if (std::empty(copy_) and not std::empty(data_)) {
+      ::munmap(const_cast<char*>(data_.data()), std::size(data_));
+    }
+#endif
+  }
+
+  [[nodiscard]] auto data() const -> std::string_view { return data_; }
+
+ private:
+  std::string_view data_{};
+  std::string copy_{};
+};
+}  // namespace detail
+
+/// Every event in the `detail::recording` encoding, appended to the --out file
+/// (ut.binlog by default) in chunks and whenever a suite finishes, so that a
+/// crashed run leaves its finished suites behind. Files are replayed into
+/// any other reporter with --replay.
+template <class TPrinter = printer>
+class reporter_binlog {
+ public:
+  static constexpr std::string_view name = "binlog";
+
+  reporter_binlog() = default;
+  reporter_binlog(const reporter_binlog&) = delete;
+  reporter_binlog& operator=(const reporter_binlog&) = delete;
+  ~reporter_binlog() { flush(); }
+
+  /// expressions are recorded without colors
+  constexpr auto operator=(TPrinter) {}
+
+  auto on(events::run_begin) -> void {
+    file_.open(detail::cfg::output_filename != ""
+                   ? detail::cfg::output_filename
+                   : std::string{"ut.binlog"},
+               std::ios::binary);
+  }
+
+  template <class TEvent>
+    requires requires(detail::recording recording, const TEvent& event) {
+      recording.on(event);
+    }
+  auto on(const TEvent& event) -> void {
+    recording_.on(event);
+    if (std::size(recording_.data()) >= chunk_size or
+        std::is_same_v<TEvent, events::suite_end> or
+        std::is_same_v<TEvent, events::fatal_assertion>) {
+      flush();
+    }
+  }
+
+  auto on(events::summary) -> void {
+    flush();
+    file_.close();
+  }
+
+ private:
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  auto flush() -> void {
+    const auto data = recording_.data();
+    if (not std::empty(data) and file_.is_open()) {
+      file_.write(data.data(), static_cast<std::streamsize>(std::size(data)));
+      file_.flush();
+    }
+    recording_.clear();
+  }
+
+  detail::recording recording_{};
+  std::ofstream file_{};
+};
+
+/// One JSON object per line and event, written while tests are running so
+/// that the output can be followed live (e.g. with `tail -f`).
+/// Lines are built in a single buffer, which is reused, and written out
+/// whenever a test or suite finishes.
+template <class TPrinter = printer>
+class reporter_jsonl {
+ public:
+  static constexpr std::string_view name = "jsonl";
+
+  explicit reporter_jsonl(std::ostream& out = std::cout) : out_{&out} {}
+  reporter_jsonl(const reporter_jsonl&) = delete;
+  reporter_jsonl& operator=(const reporter_jsonl&) = delete;
+  ~reporter_jsonl() { flush(); }
+
+  /// expressions and messages are printed without colors
+  constexpr auto operator=(TPrinter) {}
+
+  auto on(events::run_begin) -> void {
+    if (detail::cfg::output_filename != "") {
+      file_.open(detail::cfg::output_filename);
+      out_ = &file_;
+    }
+    begin("run_begin");
+    end();
+  }
+
+  auto on(events::suite_begin suite) -> void {
+    path_.emplace_back(suite.name);
+    begin("suite_begin");
+    end();
+  }
+
+  auto on(events::suite_end) -> void {
+    begin("suite_end");
+    end();
+    path_.pop_back();
+    flush();
+  }
+
+  auto on(events::test_begin test_begin) -> void {
+    push(test_begin.name);
+    begin("test_begin");
+    location(test_begin.location);
+    end();
+  }
+
+  auto on(events::test_run test_run) -> void {
+    push(test_run.name);
+    begin("test_run");
+    end();
+  }
+
+  auto on(events::test_end) -> void { pop("test_end"); }
+
+  auto on(events::test_finish) -> void { pop("test_finish"); }
+
+  auto on(events::test_skip test_skip) -> void {
+    path_.emplace_back(test_skip.name);
+    begin("test_skip");
+    end();
+    path_.pop_back();
+    ++totals_.skipped;
   }
 
   template <class TMsg>
   auto on(events::log<TMsg> log) -> void {
-    ss_out_ << log.msg;
+    begin("log");
+    field("msg");
+    if constexpr (std::is_convertible_v<const TMsg&, std::string_view>) {
+      string(log.msg);
+    } else {
+      string(format(log.msg));
+    }
+    end();
   }
 
   auto on(events::exception exception) -> void {
-    current_node_->fails++;
-    current_node_->report_string += color_.fail;
-    current_node_->report_string += "Unexpected exception with message:\n";
-    current_node_->report_string += exception.what();
-    current_node_->report_string += color_.none;
-    if (report_type_ == CONSOLE) {
-      lcout_ << getLeadingSpace();
-      lcout_ << "Running test \"" << current_node_->test_name << "\"... ";
-      lcout_ << color_.fail << "FAILED " << color_.none;
-      print_duration(lcout_);
-      lcout_ << '\n';
-      lcout_ << current_node_->report_string << '\n';
-    }
-    if (detail::cfg::abort_early ||
-        current_node_->fails >= detail::cfg::abort_after_n_failures) {
-      std::cerr << "early abort for test : " << current_node_->test_name << "after ";
-      std::cerr << current_node_->fails << " failures total." << std::endl;
-      std::exit(-1);
-    }
+    fail();
+    begin("exception");
+    field("msg");
+    string(exception.what());
+    end();
   }
 
   template <class TExpr>
   auto on(events::assertion_pass<TExpr>) -> void {
-    current_node_->assertions++;
+    pass(1);
   }
 
+  auto on(events::assertions_passed passed) -> void { pass(passed.count); }
+
   template <class TExpr>
   auto on(events::assertion_fail<TExpr> assertion) -> void {
-    TPrinter ss{};
-    ss << ss_out_.str();
-    if (report_type_ == CONSOLE) {
-      ss << getLeadingSpace();
-      ss << color_.fail << "FAILED " << color_.none;
-      print_duration(ss);
+    fail();
+    begin("assertion_fail");
+    location(assertion.location);
+    field("expr");
+    string(format(assertion.expr));
+    end();
+  }
+
+  auto on(const events::fatal_assertion&) -> void {
+    begin("fatal_assertion");
+    end();
+    flush();
+  }
+
+  auto on(events::summary) -> void {
+    begin("summary");
+    field("tests");
+    number(totals_.tests);
+    field("failed");
+    number(totals_.failed);
+    field("skipped");
+    number(totals_.skipped);
+    field("assertions_passed");
+    number(totals_.passed);
+    field("assertions_failed");
+    number(totals_.fails);
+    end();
+    flush();
+  }
+
+ private:
+  static constexpr std::size_t buffer_size = 4 * 1024;
+
+  /// test being run, assertions of nested tests also count for their parents
+  struct frame {
+    std::size_t depth{};  /// position of the test name in path_
+    detail::clock::time_point start{};
+    std::size_t passed{};
+    std::size_t fails{};
+  };
+
+  auto push(std::string_view test) -> void {
+    tests_.push_back({.depth = std::size(path_), .start = detail::clock::now()});
+    path_.emplace_back(test);
+  }
+
+  auto pop(std::string_view event) -> void {
+    const auto test = tests_.back();
+    begin(event);
+    field("duration_ns");
+    number(std::chrono::duration_cast<std::chrono::nanoseconds>(
+               detail::clock::now() - test.start)
+               .count());
+    field("assertions_passed");
+    number(test.passed);
+    field("assertions_failed");
+    number(test.fails);
+    end();
+    tests_.pop_back();
+    path_.resize(test.depth);
+    if (tests_.empty()) {
+      ++totals_.tests;
+      totals_.failed += test.fails > 0;
+    } else {
+      tests_.back().passed += test.passed;
+      tests_.back().fails += test.fails;
     }
-    ss << "in: " << assertion.location.file_name() << ':'
-       << assertion.location.line();
-    ss << color_.fail << " - test condition: ";
-    ss << '[' << std::boolalpha << assertion.expr;
-    ss << color_.fail << ']' << color_.none;
-    current_node_->report_string += ss.str();
-    current_node_->fails++;
-    current_node_->assertions++;
-    reset_printer();
-    if (report_type_ == CONSOLE) {
-      lcout_ << ss.str();
+    flush();
+  }
+
+  auto pass(const std::size_t count) -> void {
+    totals_.passed += count;
+    if (not tests_.empty()) {
+      tests_.back().passed += count;
     }
-    if (detail::cfg::abort_early ||
-        current_node_->fails >= detail::cfg::abort_after_n_failures) {
-      std::cerr << "early abort for test : " << current_node_->test_name << "after ";
-      std::cerr << current_node_->fails << " failures total." << std::endl;
-      std::exit(-1);
+  }
+
+  auto fail() -> void {
+    ++totals_.fails;
+    if (not tests_.empty()) {
+      ++tests_.back().fails;
+    }
+  }
+
+  /// `{"event":...,"ts":...,"path":[...]`, closed by `end`
+  auto begin(std::string_view event) -> void {
+    buffer_ += "{\"event\":\"";
+    buffer_ += event;
+    buffer_ += '"';
+    field("ts");
+    number(std::chrono::duration_cast<std::chrono::nanoseconds>(
+               detail::clock::now().time_since_epoch())
+               .count());
+    field("path");
+    buffer_ += '[';
+    for (auto first = true; const auto& element : path_) {
+      if (not std::exchange(first, false)) {
+        buffer_ += ',';
+      }
+      string(element);
+    }
+    buffer_ += ']';
+  }
+
+  auto end() -> void {
+    buffer_ += "}\n";
+    if (std::size(buffer_) >= buffer_size) {
+      flush();
+    }
+  }
+
+  auto flush() -> void {
+    if (not std::empty(buffer_)) {
+      out_->write(buffer_.data(), static_cast<std::streamsize>(std::size(buffer_)));
+      out_->flush();
+      buffer_.clear();
+    }
+  }
+
+  auto field(std::string_view key) -> void {
+    buffer_ += ",\"";
+    buffer_ += key;
+    buffer_ += "\":";
+  }
+
+  auto location(const reflection::source_location& location) -> void {
+    field("file");
+    string(location.file_name());
+    field("line");
+    number(location.line());
+  }
+
+  template <class T>
+  auto number(const T value) -> void {
+    std::array<char, 24> chars{};
+    const auto [last, ec] =
+        std::to_chars(chars.data(), chars.data() + std::size(chars), value);
+    buffer_.append(chars.data(), last);
+  }
+
+  auto string(std::string_view text) -> void {
+    detail::append_quoted(buffer_, text);
+  }
+
+  /// expressions and messages are printed without colors
+  template <class T>
+  [[nodiscard]] static auto format(const T& t) -> std::string {
+    TPrinter printer{colors{.none = "", .pass = "", .fail = "", .skip = ""}};
+    printer << std::boolalpha << t;
+    return printer.str();
+  }
+
+  std::ostream* out_{};
+  std::ofstream file_{};
+  std::string buffer_{};
+  std::vector<std::string> path_{};
+  std::vector<frame> tests_{};
+  struct {
+    std::size_t tests{};
+    std::size_t failed{};
+    std::size_t skipped{};
+    std::size_t passed{};
+    std::size_t fails{};
+  } totals_{};
+};
+
+/// TAP version 14, nested tests (and the tests of a suite) are reported as
+/// subtests and failures as YAML diagnostics of their test point.
+/// Every line is written and flushed as soon as it is known.
+template <class TPrinter = printer>
+class reporter_tap {
+ public:
+  static constexpr std::string_view name = "tap";
+
+  explicit reporter_tap(std::ostream& out = std::cout) : out_{&out} {}
+  reporter_tap(const reporter_tap&) = delete;
+  reporter_tap& operator=(const reporter_tap&) = delete;
+
+  /// expressions and messages are printed without colors
+  constexpr auto operator=(TPrinter) {}
+
+  auto on(events::run_begin) -> void {
+    if (detail::cfg::output_filename != "") {
+      file_.open(detail::cfg::output_filename);
+      out_ = &file_;
+    }
+  }
+
+  auto on(events::suite_begin suite) -> void { begin(suite.name); }
+  auto on(events::suite_end) -> void { end(); }
+  auto on(events::test_begin test_begin) -> void { begin(test_begin.name); }
+  auto on(events::test_end) -> void { end(); }
+  auto on(events::test_run test_run) -> void { begin(test_run.name); }
+  auto on(events::test_finish) -> void { end(); }
+
+  auto on(events::test_skip test_skip) -> void {
+    begin(test_skip.name);
+    frames_.back().skipped = true;
+    end();
+  }
+
+  template <class TMsg>
+  auto on(events::log<TMsg> log) -> void {
+    auto& test = frames_.back();
+    if constexpr (std::is_convertible_v<const TMsg&, std::string_view>) {
+      test.log += std::string_view{log.msg};
+    } else {
+      test.log += format(log.msg);
+    }
+    for (auto eol = test.log.find('\n'); eol != std::string::npos;
+         eol = test.log.find('\n')) {
+      comment(std::string_view{test.log}.substr(0, eol));
+      test.log.erase(0, eol + 1);
+    }
+  }
+
+  auto on(events::exception exception) -> void {
+    auto& test = frames_.back();
+    test.failed = true;
+    test.diagnostics += "exception: ";
+    detail::append_quoted(test.diagnostics, exception.what());
+    test.diagnostics += '\n';
+  }
+
+  template <class TExpr>
+  auto on(events::assertion_fail<TExpr> assertion) -> void {
+    auto& test = frames_.back();
+    test.failed = true;
+    test.diagnostics += "- at:\n    file: ";
+    detail::append_quoted(test.diagnostics, assertion.location.file_name());
+    test.diagnostics += "\n    line: ";
+    test.diagnostics += std::to_string(assertion.location.line());
+    test.diagnostics += "\n  expr: ";
+    detail::append_quoted(test.diagnostics, format(assertion.expr));
+    test.diagnostics += '\n';
+  }
+
+  auto on(const events::fatal_assertion&) -> void {
+    line(0) << "Bail out! terminated for the fatal issue\n" << std::flush;
+    bailed_out_ = true;
+  }
+
+  auto on(events::summary) -> void {
+    if (not bailed_out_) {
+      line(0) << "1.." << frames_.front().points << '\n' << std::flush;
     }
   }
 
-  auto on(const events::fatal_assertion&) -> void {
-    TPrinter ss{};
-    ss << ss_out_.str() << "\n=> " << color_.fail << "terminated for the fatal issue" << color_.none;
-    current_node_->report_string += ss.str();
-    reset_printer();
-    if (report_type_ == CONSOLE) {
-      lcout_ << ss.str();
-    }
-    while (current_node_->parent != nullptr) {
-      count_result();
+ private:
+  /// frames_[0] is the run itself, the lines of the children of frames_[i]
+  /// are indented by i levels
+  struct frame {
+    std::string name{};
+    std::size_t points{};  /// children reported so far
+    bool subtest{};        /// `# Subtest:` has been written
+    bool failed{};
+    bool skipped{};
+    std::string diagnostics{};
+    std::string log{};     /// incomplete line of logged messages
+  };
+
+  auto begin(std::string_view test) -> void {
+    if (std::size(frames_) > 1 and not frames_.back().subtest) {
+      frames_.back().subtest = true;
+      line(std::size(frames_) - 2)
+          << "# Subtest: " << frames_.back().name << '\n' << std::flush;
+    }
+    frames_.push_back({.name = std::string{test}});
+  }
+
+  auto end() -> void {
+    if (not std::empty(frames_.back().log)) {
+      comment(frames_.back().log);
+    }
+    const auto test = std::move(frames_.back());
+    frames_.pop_back();
+    const auto level = std::size(frames_) - 1;  // of the test point
+    if (test.subtest) {
+      line(level + 1) << "1.." << test.points << '\n';
+    }
+    auto& parent = frames_.back();
+    parent.failed = parent.failed or test.failed;
+    line(level) << (test.failed ? "not ok " : "ok ") << ++parent.points
+                << " - " << test.name << (test.skipped ? " # SKIP\n" : "\n");
+    if (not std::empty(test.diagnostics)) {
+      line(level) << "  ---\n";
+      for (std::string_view lines{test.diagnostics}; not std::empty(lines);) {
+        const auto eol = lines.find('\n') + 1;
+        line(level) << "  " << lines.substr(0, eol);
+        lines.remove_prefix(eol);
+      }
+      line(level) << "  ...\n";
+    }
+    out_->flush();
+  }
+
+  /// written along the test points of the current test
+  auto comment(std::string_view text) -> void {
+    const auto level = std::size(frames_) - 1;
+    line(frames_.back().subtest or level == 0 ? level : level - 1)
+        << "# " << text << '\n' << std::flush;
+  }
+
+  /// starts a line indented by `levels` subtests (after the version line)
+  auto line(const std::size_t levels) -> std::ostream& {
+    if (not std::exchange(started_, true)) {
+      *out_ << "TAP version 14\n";
+    }
+    for (auto i = 0u; i < levels; ++i) {
+      *out_ << "    ";
+    }
+    return *out_;
+  }
+
+  /// expressions and messages are printed without colors
+  template <class T>
+  [[nodiscard]] static auto format(const T& t) -> std::string {
+    TPrinter printer{colors{.none = "", .pass = "", .fail = "", .skip = ""}};
+    printer << std::boolalpha << t;
+    return printer.str();
+  }
+
+  std::ostream* out_{};
+  std::ofstream file_{};
+  std::vector<frame> frames_{frame{}};
+  bool started_{};
+  bool bailed_out_{};
+};
+
+template <class TPrinter = printer>
+class reporter_junit {
+  using clock_ref = detail::clock;
+  using timePoint = std::chrono::time_point<clock_ref>;
+  using timeDiff = std::chrono::nanoseconds;
+  enum class ReportType : std::uint8_t { CONSOLE, JUNIT } report_type_{};
+  static constexpr ReportType CONSOLE = ReportType::CONSOLE;
+  static constexpr ReportType JUNIT = ReportType::JUNIT;
+  enum class StatusType : std::uint8_t { UNDEFINED, PASSED, FAILED, SKIPPED };
+  static constexpr StatusType UNDEFINED = StatusType::UNDEFINED;
+  static constexpr StatusType PASSED = StatusType::PASSED;
+  static constexpr StatusType FAILED = StatusType::FAILED;
+  static constexpr StatusType SKIPPED = StatusType::SKIPPED;
+  inline static const std::string statusStrings[] = { "UNDEFINED", "PASSED", "FAILED", "SKIPPED" };
+
+  /// Results are allocated, together with their names and reports, from the
+  /// monotonic arena of their suite and released all at once with it.
+  struct test_result {
+    std::string_view test_name;
+    test_result* parent = nullptr;
+    StatusType status = UNDEFINED;
+    timePoint run_start = clock_ref::now();
+    timePoint run_stop = clock_ref::now();
+    std::size_t n_tests = 0LU;
+    std::size_t fail_tests = 0LU;
+    std::size_t assertions = 0LU;
+    std::size_t skipped = 0LU;
+    std::size_t fails = 0LU;
+    std::pmr::string report_string;
+    std::pmr::vector<test_result*> children;
+
+    test_result(std::string_view name, test_result* p,
+                std::pmr::memory_resource* arena)
+        : test_name(intern(name, arena)),
+          parent(p),
+          report_string(arena),
+          children(arena) {}
+    test_result(const test_result&) = delete;
+    test_result& operator=(const test_result&) = delete;
+    test_result& add_child(std::string_view name) {
+      std::pmr::polymorphic_allocator<> allocator{children.get_allocator()};
+      return *children.emplace_back(allocator.new_object<test_result>(
+          name, this, allocator.resource()));
+    }
+
+    [[nodiscard]] static auto intern(std::string_view name,
+                                     std::pmr::memory_resource* arena)
+        -> std::string_view {
+      auto* data = static_cast<char*>(arena->allocate(std::size(name), 1));
+      std::copy(name.begin(), name.end(), data);
+      return {data, std::size(name)};
+    }
+  };
+
+  /// the first results of a suite fit into its initial buffer
+  struct suite_arena {
+    std::array<std::byte, 4 * 1024> buffer{};
+    std::pmr::monotonic_buffer_resource arena{buffer.data(), std::size(buffer)};
+  };
+
+  struct suite_node : suite_arena, test_result {
+    explicit suite_node(std::string_view name)
+        : test_result{name, nullptr, &this->arena} {}
+    detail::duration_histogram durations{};  /// of its top-level tests
+  };
+
+  /// one of the --slowest tests, the names are copied as the suites may be
+  /// released before the end (--stream)
+  struct slow_test {
+    timeDiff duration{};
+    std::string suite_name{};
+    std::string test_name{};
+  };
+  inline static int layer_ = 0;
+  colors color_{};
+  std::vector<std::unique_ptr<suite_node>> suites_results_;
+  test_result* current_node_ = nullptr;
+
+  std::streambuf* cout_save = std::cout.rdbuf();
+  std::ostream lcout_;
+  TPrinter printer_;
+  TPrinter message_{};  /// reused to format failures
+  std::stringstream ss_out_{};
+
+  static constexpr std::size_t junit_totals_size = 96;
+  std::ofstream junit_file_{};
+  std::ostream* junit_stream_{};  /// set while streaming suites (--stream)
+  std::streampos junit_totals_{};
+
+  struct {
+    std::size_t tests{};
+    std::size_t fails{};
+    timeDiff time{};
+  } streamed_{};
+  std::vector<slow_test> slowest_{};  /// min-heap of the --slowest tests
+  detail::repetitions repeated_{};
+
+  void reset_printer() {
+    ss_out_.str("");
+    ss_out_.clear();
+  }
+
+  void add_node(std::string_view node_name) {
+    if (current_node_->parent == nullptr) {
+      reset_printer();
+    }
+    layer_++;
+    current_node_ = &current_node_->add_child(node_name);
+  }
+
+  void count_result() {
+    current_node_->run_stop = clock_ref::now();
+    current_node_->status =
+        current_node_->fails > 0
+        ? FAILED : (current_node_->skipped ? SKIPPED : PASSED);
+    auto parent = current_node_->parent;
+    if (parent != nullptr and parent->parent == nullptr and
+        current_node_->status != SKIPPED) {
+      time_test(static_cast<suite_node&>(*parent), *current_node_);
+    }
+    if (parent != nullptr) {
+      parent->n_tests += 1LU;
+      if ((current_node_->fails > 0 || current_node_->fail_tests > 0)) {
+        parent->fail_tests++;
+      }
+      parent->assertions += current_node_->assertions;
+      parent->skipped += current_node_->skipped;
+      parent->fails += current_node_->fails;
+    }
+    current_node_ = parent;
+    layer_--;
+  }
+
+  inline std::string getLeadingSpace() {
+    return layer_ > 0 ? "\n" + std::string(2 * (layer_ - 1), ' ')
+                      : "\n";
+  }
+
+ public:
+  constexpr auto operator=(TPrinter printer) {
+    printer_ = static_cast<TPrinter&&>(printer);
+  }
+  reporter_junit() : lcout_(std::cout.rdbuf()) {
+    suites_results_.emplace_back(std::make_unique<suite_node>("global"));
+    current_node_ = suites_results_.front().get();
+  }
+  ~reporter_junit() { std::cout.rdbuf(cout_save); }
+
+  auto on(events::run_begin run) {
+    ::boost::ut::detail::cfg::parse_arg_with_fallback(run.argc, run.argv);
+
+    if (detail::cfg::show_reporters) {
+      std::cout << "available reporter:\n";
+      std::cout << "  console (default)\n";
+      std::cout << "  junit" << std::endl;
+      std::exit(0);
+    }
+    if (detail::cfg::use_reporter.starts_with("junit")) {
+      report_type_ = JUNIT;
+    } else {
+      report_type_ = CONSOLE;
+    }
+    if (report_type_ == JUNIT or !detail::cfg::use_colour.starts_with("yes")) {
+      color_ = {"", "", "", ""};
+    }
+    if (!detail::cfg::show_tests && !detail::cfg::show_test_names) {
+      std::cout.rdbuf(ss_out_.rdbuf());
+    }
+    if (report_type_ == JUNIT and detail::cfg::stream_junit) {
+      begin_junit_stream();
+    }
+  }
+
+  auto on(events::suite_begin suite) -> void {
+    suites_results_.emplace_back(std::make_unique<suite_node>(suite.name));
+    current_node_ = suites_results_.back().get();
+  }
+
+  auto on(events::suite_end) -> void {
+    current_node_->run_stop = clock_ref::now();
+    current_node_ = suites_results_.front().get();
+    if (junit_stream_ and std::size(suites_results_) > 1) {
+      stream_suite(std::move(suites_results_.back()));
+      suites_results_.pop_back();
+    }
+  }
+
+  auto on(events::test_begin test_event) -> void {  // starts outermost test
+    add_node(test_event.name);
+    if (report_type_ == CONSOLE) {
+      ss_out_ << getLeadingSpace();
+      ss_out_ << "Running " << test_event.type << " \"" << test_event.name
+              << "\"... ";
+    }
+  }
+
+  auto on(events::test_end test_event) -> void {
+    current_node_->report_string += ss_out_.view();
+    if (report_type_ == CONSOLE) {
+      if (current_node_->fails > 0) {
+        lcout_ << ss_out_.str();
+      }
+      else if (detail::cfg::show_successful_tests or exceeds_min_duration()) {
+        if (!current_node_->children.empty()) {
+          ss_out_ << getLeadingSpace();
+          ss_out_ << "Running test \"" << test_event.name << "\" ... ";
+        }
+        ss_out_ << color_.pass << "PASSED " << color_.none;
+        print_duration(ss_out_);
+        lcout_ << ss_out_.str();
+      }
+    }
+    reset_printer();
+    count_result();
+  }
+
+  auto on(events::test_run test_event) -> void {  // starts nested test
+    on(events::test_begin{.type = test_event.type, .name = test_event.name});
+  }
+
+  auto on(events::test_finish test_event) -> void {  // finishes nested test
+    on(events::test_end{.type = test_event.type, .name = test_event.name});
+  }
+
+  auto on(events::test_skip test_event) -> void {
+    ss_out_.clear();
+    add_node(test_event.name);
+    current_node_->status = SKIPPED;
+    current_node_->skipped += 1;
+    if (report_type_ == CONSOLE) {
+      lcout_ << getLeadingSpace();
+      lcout_ << "Running \"" << test_event.name << "\"... ";
+      lcout_ << color_.skip << "SKIPPED" << color_.none;
+    }
+    reset_printer();
+    count_result();
+  }
+
+  template <class TMsg>
+  auto on(events::log<TMsg> log) -> void {
+    ss_out_ << log.msg;
+  }
+
+  auto on(events::exception exception) -> void {
+    current_node_->fails++;
+    current_node_->report_string += color_.fail;
+    current_node_->report_string += "Unexpected exception with message:\n";
+    current_node_->report_string += exception.what();
+    current_node_->report_string += color_.none;
+    if (report_type_ == CONSOLE) {
+      lcout_ << getLeadingSpace();
+      lcout_ << "Running test \"" << current_node_->test_name << "\"... ";
+      lcout_ << color_.fail << "FAILED " << color_.none;
+      print_duration(lcout_);
+      lcout_ << '\n';
+      lcout_ << current_node_->report_string << '\n';
+    }
+    if (detail::cfg::abort_early ||
+        current_node_->fails >= detail::cfg::abort_after_n_failures) {
+      std::cerr << "early abort for test : " << current_node_->test_name << "after ";
+      std::cerr << current_node_->fails << " failures total." << std::endl;
+      std::exit(-1);
+    }
+  }
+
+  template <class TExpr>
+  auto on(events::assertion_pass<TExpr>) -> void {
+    current_node_->assertions++;
+  }
+
+  auto on(events::assertions_passed passed) -> void {
+    current_node_->assertions += passed.count;
+  }
+
+  template <class TExpr>
+  auto on(events::assertion_fail<TExpr> assertion) -> void {
+    auto& ss = message_;
+    ss.clear();
+    ss << ss_out_.view();
+    if (report_type_ == CONSOLE) {
+      ss << getLeadingSpace();
+      ss << color_.fail << "FAILED " << color_.none;
+      print_duration(ss);
+    }
+    ss << "in: " << assertion.location.file_name() << ':'
+       << assertion.location.line();
+    ss << color_.fail << " - test condition: ";
+    ss << '[' << std::boolalpha << assertion.expr;
+    ss << color_.fail << ']' << color_.none;
+    current_node_->report_string += ss.view();
+    current_node_->fails++;
+    current_node_->assertions++;
+    reset_printer();
+    if (report_type_ == CONSOLE) {
+      lcout_ << ss.view();
+    }
+    if (detail::cfg::abort_early ||
+        current_node_->fails >= detail::cfg::abort_after_n_failures) {
+      std::cerr << "early abort for test : " << current_node_->test_name << "after ";
+      std::cerr << current_node_->fails << " failures total." << std::endl;
+      std::exit(-1);
+    }
+  }
+
+  auto on(const events::fatal_assertion&) -> void {
+    auto& ss = message_;
+    ss.clear();
+    ss << ss_out_.view() << "\n=> " << color_.fail << "terminated for the fatal issue" << color_.none;
+    current_node_->report_string += ss.view();
+    reset_printer();
+    if (report_type_ == CONSOLE) {
+      lcout_ << ss.view();
+    }
+    while (current_node_->parent != nullptr) {
+      count_result();
+    }
+  }
+
+  auto on(const events::repetitions& repetitions) -> void {
+    repeated_.on(repetitions);
+  }
+
+  auto on(events::summary) -> void {
+    std::cout.flush();
+    std::cout.rdbuf(cout_save);
+    suites_results_.front()->run_stop = clock_ref::now();
+    if (junit_stream_) {
+      end_junit_stream();
+      return;
+    }
+    std::ofstream maybe_of;
+    if (detail::cfg::output_filename != "") {
+      maybe_of = std::ofstream(detail::cfg::output_filename);
+    }
+
+    if (report_type_ == JUNIT) {
+      print_junit_summary(detail::cfg::output_filename != "" ? maybe_of
+                                                             : std::cout);
+      return;
+    }
+    lcout_ << ss_out_.str();
+    print_console_summary(
+        detail::cfg::output_filename != "" ? maybe_of : std::cout,
+        detail::cfg::output_filename != "" ? maybe_of : std::cerr);
+    if (detail::cfg::show_duration or detail::cfg::show_min_duration > 0) {
+      print_durations_summary(detail::cfg::output_filename != "" ? maybe_of
+                                                                 : std::cout);
+    }
+  }
+
+ protected:
+  inline double get_duration(const test_result* test_node) const {
+    return std::chrono::duration<double>(test_node->run_stop -
+                                         test_node->run_start)
+        .count();
+  }
+
+  [[nodiscard]] static auto elapsed(const test_result* test_node) -> timeDiff {
+    return std::chrono::duration_cast<timeDiff>(test_node->run_stop -
+                                                test_node->run_start);
+  }
+
+  /// of the current test, which is still running
+  [[nodiscard]] auto running_time() const -> timeDiff {
+    return std::chrono::duration_cast<timeDiff>(clock_ref::now() -
+                                                current_node_->run_start);
+  }
+
+  /// -D, --min-duration: only tests taking at least that many seconds
+  [[nodiscard]] auto exceeds_min_duration() const -> bool {
+    return detail::cfg::show_min_duration > 0 and
+           running_time() >=
+               std::chrono::seconds{detail::cfg::show_min_duration};
+  }
+
+  inline void print_duration(auto& printer) const noexcept {
+    if (detail::cfg::show_duration or exceeds_min_duration()) {
+      printer << "after " << detail::fixed_seconds{running_time()}
+              << " seconds ";
+    }
+  }
+
+  void time_test(suite_node& suite, const test_result& test_node) {
+    const auto duration = elapsed(&test_node);
+    suite.durations.add(duration);
+    if (std::chrono::seconds{detail::cfg::show_min_duration} > duration) {
+      return;
+    }
+    constexpr auto slower = [](const slow_test& lhs, const slow_test& rhs) {
+      return lhs.duration > rhs.duration;
+    };
+    if (std::size(slowest_) < detail::cfg::slowest_tests) {
+      slowest_.push_back({});
+    } else if (not std::empty(slowest_) and
+               duration > slowest_.front().duration) {
+      std::pop_heap(slowest_.begin(), slowest_.end(), slower);
+    } else {
+      return;
+    }
+    slowest_.back().duration = duration;
+    slowest_.back().suite_name = suite.test_name;
+    slowest_.back().test_name = test_node.test_name;
+    std::push_heap(slowest_.begin(), slowest_.end(), slower);
+  }
+
+  /// the --slowest tests and the percentiles of each suite
+  void print_durations_summary(std::ostream& out_stream) {
+    std::sort_heap(slowest_.begin(), slowest_.end(),
+                   [](const slow_test& lhs, const slow_test& rhs) {
+                     return lhs.duration > rhs.duration;
+                   });
+    if (std::size(slowest_) > detail::cfg::slowest_tests) {
+      slowest_.resize(detail::cfg::slowest_tests);  // timed before --slowest
+    }
+    if (not std::empty(slowest_)) {
+      out_stream << "\n\nSlowest " << std::size(slowest_) << " tests:";
+      for (const auto& test : slowest_) {
+        out_stream << "\n  " << detail::fixed_seconds{test.duration} << "s  "
+                   << test.suite_name << " \"" << test.test_name << '"';
+      }
+    }
+    slowest_.clear();
+    out_stream << "\n\nDurations per suite (p50 | p90 | p99):";
+    for (const auto& suite_result : suites_results_) {
+      const auto& durations = suite_result->durations;
+      if (durations.count() == 0) {
+        continue;
+      }
+      out_stream << "\n  " << suite_result->test_name << ": "
+                 << detail::fixed_seconds{durations.percentile(.50)} << "s | "
+                 << detail::fixed_seconds{durations.percentile(.90)} << "s | "
+                 << detail::fixed_seconds{durations.percentile(.99)} << "s ("
+                 << durations.count() << " tests)";
+    }
+    out_stream << '\n';
+    out_stream.flush();
+  }
+
+  void print_console_summary(std::ostream& out_stream,
+                             std::ostream& err_stream) {
+    for (const auto& suite_result : suites_results_) {
+      if (suite_result->fails) {
+        err_stream
+            << "\n========================================================"
+               "=======================\n"
+            << "Suite " << suite_result->test_name << '\n'
+            << "tests:   " << (suite_result->n_tests) << " | "
+            << (suite_result->fail_tests > 0 ? color_.fail : color_.none)
+            << suite_result->fail_tests << " failed" << color_.none << '\n'
+            << "asserts: " << (suite_result->assertions) << " | "
+            << (suite_result->assertions - suite_result->fails) << " passed"
+            << " | " << color_.fail << suite_result->fails << " failed"
+            << color_.none;
+      } else if (suite_result->assertions || suite_result->n_tests ||
+                 suite_result->skipped) {
+        out_stream
+            << color_.pass << "\nSuite '" << suite_result->test_name
+            << "': all tests passed" << color_.none << " ("
+            << suite_result->assertions << " asserts in "
+            << suite_result->n_tests << " tests)";
+      }
+      if (suite_result->skipped) {
+        std::cout << "; " << color_.skip << suite_result->skipped
+                  << " tests skipped" << color_.none;
+      }
+      std::cout.flush();
+    }
+    repeated_.print(out_stream);
+  }
+
+  void print_junit_summary(std::ostream& stream) {
+    // aggregate results
+    size_t n_tests = 0;
+    size_t n_fails = 0;
+    timeDiff total_time{};
+    for (const auto& suite_result : suites_results_) {
+      n_tests += suite_result->assertions;
+      n_fails += suite_result->fails;
+      total_time += elapsed(suite_result.get());
+    }
+
+    // mock junit output:
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    stream << "<testsuites";
+    stream << " name=\"all\"";
+    stream << junit_totals(n_tests, n_fails, total_time);
+    stream << ">\n";
+
+    for (const auto& suite_result : suites_results_) {
+      print_junit_suite(stream, *suite_result);
+    }
+    stream << "</testsuites>";
+  }
+
+  [[nodiscard]] static auto junit_totals(std::size_t n_tests,
+                                         std::size_t n_fails,
+                                         timeDiff total_time) -> std::string {
+    std::stringstream totals{};
+    totals << " tests=\"" << n_tests << '\"';
+    totals << " failures=\"" << n_fails << '\"';
+    totals << " time=\"" << detail::fixed_seconds{total_time} << '\"';
+    return totals.str();
+  }
+
+  void print_junit_suite(std::ostream& stream,
+                         const test_result& suite_result) {
+    stream << "<testsuite";
+    stream << " classname=\""
+           << detail::xml_escaped{detail::cfg::executable_name} << '\"';
+    stream << " name=\"" << detail::xml_escaped{suite_result.test_name}
+           << '\"';
+    stream << " tests=\"" << suite_result.assertions << '\"';
+    stream << " errors=\"" << suite_result.fails << '\"';
+    stream << " failures=\"" << suite_result.fails << '\"';
+    stream << " skipped=\"" << suite_result.skipped << '\"';
+    stream << " time=\"" << detail::fixed_seconds{elapsed(&suite_result)} << '\"';
+    stream << " version=\"" << BOOST_UT_VERSION << "\">\n";
+    print_result(stream, suite_result.test_name, " ", suite_result);
+    stream << "</testsuite>\n";
+    stream.flush();
+  }
+
+  /// --stream: the totals are unknown until the end, so a file gets
+  /// padding which is overwritten at exit, other streams go without them
+  void begin_junit_stream() {
+    if (detail::cfg::output_filename != "") {
+      junit_file_.open(detail::cfg::output_filename);
+      junit_stream_ = &junit_file_;
+    } else {
+      junit_stream_ = &lcout_;
+    }
+    *junit_stream_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    *junit_stream_ << "<testsuites";
+    *junit_stream_ << " name=\"all\"";
+    if (junit_stream_ == &junit_file_) {
+      junit_totals_ = junit_file_.tellp();
+      *junit_stream_ << std::string(junit_totals_size, ' ');
+    }
+    *junit_stream_ << ">\n";
+    junit_stream_->flush();
+  }
+
+  void stream_suite(std::unique_ptr<suite_node> suite_result) {
+    streamed_.tests += suite_result->assertions;
+    streamed_.fails += suite_result->fails;
+    streamed_.time += elapsed(suite_result.get());
+    print_junit_suite(*junit_stream_, *suite_result);
+  }
+
+  void end_junit_stream() {
+    for (auto& suite_result : suites_results_) {
+      stream_suite(std::move(suite_result));
+    }
+    suites_results_.clear();
+    *junit_stream_ << "</testsuites>";
+    if (junit_stream_ == &junit_file_) {
+      const auto totals =
+          junit_totals(streamed_.tests, streamed_.fails, streamed_.time);
+      if (std::size(totals) <= junit_totals_size) {
+        junit_file_.seekp(junit_totals_);
+        junit_file_ << totals;
+      }
+    }
+    junit_stream_->flush();
+    junit_stream_ = nullptr;
+  }
+
+  void print_result(std::ostream& stream, std::string_view suite_name,
+                    const std::string& indent, const test_result& test_node) {
+    for (const auto& child_result : test_node.children) {
+      stream << indent;
+      stream << "<testcase classname=\"" << detail::xml_escaped{suite_name}
+             << '\"';
+      stream << " name=\"" << detail::xml_escaped{child_result->test_name}
+             << '\"';
+      stream << " tests=\"" << child_result->assertions << '\"';
+      stream << " errors=\"" << child_result->fails << '\"';
+      stream << " failures=\"" << child_result->fails << '\"';
+      stream << " skipped=\"" << child_result->skipped << '\"';
+      stream << " time=\"" << detail::fixed_seconds{elapsed(child_result)}
+             << "\"";
+      stream << " status=\"" << statusStrings[(int)child_result->status]
+             << '\"';
+      if (child_result->report_string.empty() &&
+          child_result->children.empty()) {
+        stream << " />\n";
+      } else if (!child_result->children.empty()) {
+        stream << ">\n";
+        print_result(stream, suite_name, indent + "  ", *child_result);
+        stream << indent << "</testcase>\n";
+      } else if (!child_result->report_string.empty()) {
+        stream << ">\n";
+        stream << indent << indent << "<system-out>\n";
+        stream << detail::xml_escaped{child_result->report_string} << "\n";
+        stream << indent << indent << "</system-out>\n";
+        stream << indent << "</testcase>\n";
+      }
+    }
+  }
+};
+
+/// Reports with the reporter chosen by --reporter at the beginning of the run,
+/// the first of `TReporters` whose `name` it starts with, and with `TDefault`
+/// (console or junit) otherwise.
+template <class TDefault, class... TReporters>
+class reporter_select {
+ public:
+  auto operator=(const colors& colors) -> void {
+    std::visit([&](auto& reporter) { reporter = {colors}; }, reporter_);
+  }
+
+  auto on(events::run_begin run) -> void {
+    ::boost::ut::detail::cfg::parse_arg_with_fallback(run.argc, run.argv);
+
+    if (detail::cfg::show_reporters) {
+      std::cout << "available reporter:\n";
+      std::cout << "  console (default)\n";
+      std::cout << "  junit\n";
+      ((std::cout << "  " << TReporters::name << '\n'), ...);
+      std::cout.flush();
+      std::exit(0);
+    }
+    select(std::index_sequence_for<TReporters...>{});
+    std::visit([&](auto& reporter) { reporter.on(run); }, reporter_);
+  }
+
+  template <class TEvent>
+  auto on(const TEvent& event) -> void {
+    std::visit(
+        [&](auto& reporter) {
+          if constexpr (requires { reporter.on(event); }) {
+            reporter.on(event);
+          }
+        },
+        reporter_);
+  }
+
+ private:
+  template <std::size_t... Ns>
+  auto select(std::index_sequence<Ns...>) -> void {
+    static_cast<void>(
+        (... or (detail::cfg::use_reporter.starts_with(TReporters::name) and
+                 (reporter_.template emplace<Ns + 1>(), true))));
+  }
+
+  std::variant<TDefault, TReporters...> reporter_{};
+};
+
+namespace detail {
+/// Assertions made by threads spawned from tests (not owned by the runner).
+/// Passes are counted per thread with relaxed atomics and failures/logs are
+/// pushed onto a lock-free stack, both are drained by the thread running the
+/// test at the next test boundary.
+class channel {
+ public:
+  struct message {
+    std::string text{};
+    reflection::source_location location{};
+    bool log{};  /// logged message rather than failed assertion
+    message* next{};
+  };
+
+  channel() = default;
+  channel(const channel&) = delete;
+  channel& operator=(const channel&) = delete;
+  ~channel() {
+    for (auto* it = slots_.load(); it;) {
+      delete std::exchange(it, it->next);
+    }
+    for (auto* msg = messages_.load(); msg;) {
+      delete std::exchange(msg, msg->next);
+    }
+  }
+
+  auto pass() -> void {
+    auto& count = local().count;  // single writer
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  template <class TExpr>
+  auto fail(const TExpr& expr, const reflection::source_location& location)
+      -> void {
+    push(new message{.text = recording::format(expr), .location = location});
+  }
+
+  template <class TMsg>
+  auto log(const TMsg& msg) -> void {
+    if constexpr (std::is_convertible_v<const TMsg&, std::string_view>) {
+      push(new message{.text = std::string{std::string_view{msg}}, .log = true});
+    } else {
+      push(new message{.text = recording::format(msg), .log = true});
+    }
+  }
+
+  /// passes not drained yet and pending messages, in the order of pushing
+  template <class TPasses, class TMessage>
+  auto drain(TPasses on_passes, TMessage on_message) -> void {
+    std::size_t total{};
+    for (auto* it = slots_.load(std::memory_order_acquire); it; it = it->next) {
+      total += it->count.load(std::memory_order_relaxed);
+    }
+    auto drained = drained_.load(std::memory_order_relaxed);
+    while (drained < total and
+           not drained_.compare_exchange_weak(drained, total,
+                                              std::memory_order_relaxed)) {
+    }
+    if (drained < total) {
+      on_passes(total - drained);
+    }
+
+    message* pending{};
+    for (auto* msg = messages_.exchange(nullptr, std::memory_order_acquire);
+         msg;) {
+      auto* next = std::exchange(msg->next, pending);
+      pending = std::exchange(msg, next);
+    }
+    while (pending) {
+      on_message(*pending);
+      delete std::exchange(pending, pending->next);
+    }
+  }
+
+  /// threads which passed assertions, at most one slot per thread
+  [[nodiscard]] auto slots() const -> std::size_t {
+    std::size_t size{};
+    for (auto* it = slots_.load(std::memory_order_acquire); it; it = it->next) {
+      ++size;
+    }
+    return size;
+  }
+
+ private:
+  struct slot {
+    std::atomic<std::size_t> count{};
+    slot* next{};
+  };
+
+  /// The slot of the calling thread. Each thread caches its slots by channel
+  /// id (ids are never reused, so entries of destroyed channels never match),
+  /// the most recently used first, so that switching between channels reuses
+  /// the slots rather than allocating new ones.
+  auto local() -> slot& {
+    static constexpr auto max_cached = 8u;
+    thread_local std::vector<std::pair<std::size_t, slot*>> cache{};
+    const auto it = std::find_if(
+        cache.begin(), cache.end(),
+        [this](const auto& entry) { return entry.first == id_; });
+    if (it != cache.end()) {
+      std::rotate(cache.begin(), it, std::next(it));
+      return *cache.front().second;
+    }
+    auto* local = new slot{.next = slots_.load(std::memory_order_relaxed)};
+    while (not slots_.compare_exchange_weak(local->next, local,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+    }
+    if (std::size(cache) == max_cached) {
+      cache.pop_back();
+    }
+    cache.insert(cache.begin(), {id_, local});
+    return *local;
+  }
+
+  auto push(message* msg) -> void {
+    msg->next = messages_.load(std::memory_order_relaxed);
+    while (not messages_.compare_exchange_weak(msg->next, msg,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+    }
+  }
+
+  static inline std::atomic<std::size_t> ids_{};
+  const std::size_t id_{++ids_};
+  std::atomic<slot*> slots_{};
+  std::atomic<std::size_t> drained_{};
+  std::atomic<message*> messages_{};
+};
+
+/// Interns tag names to small ids, so that the tags of a test become a
+/// bitset and --tag filters are matched once per distinct tag.
+class tag_index {
+ public:
+  class bits {
+   public:
+    auto insert(std::size_t id) -> void {
+      if (id / word >= std::size(words_)) {
+        words_.resize(id / word + 1);
+      }
+      words_[id / word] |= std::uint64_t{1} << (id % word);
+    }
+    [[nodiscard]] auto contains(std::size_t id) const -> bool {
+      return id / word < std::size(words_) and
+             (words_[id / word] >> (id % word)) & 1u;
+    }
+    [[nodiscard]] auto intersects(const bits& other) const -> bool {
+      const auto size = math::min_value(std::size(words_), std::size(other.words_));
+      for (auto i = 0u; i < size; ++i) {
+        if (words_[i] & other.words_[i]) {
+          return true;
+        }
+      }
+      return false;
+    }
+    auto clear() -> void { words_.clear(); }
+
+   private:
+    static constexpr std::size_t word = 64;
+    std::vector<std::uint64_t> words_{};
+  };
+
+  struct match {
+    bool skip{};      /// tagged "skip"
+    bool serial{};    /// no tags but "serial"
+    bool selected{};  /// a tag matches a --tag filter
+    bool queried{};   /// a tag matches the query pattern
+  };
+
+  /// glob patterns of the tags to run
+  auto filter(const std::vector<std::string_view>& patterns) -> void {
+    const std::lock_guard lock{mutex_};
+    patterns_.assign(std::begin(patterns), std::end(patterns));
+    selected_.clear();
+    for (auto id = 0u; id < std::size(names_); ++id) {
+      select(id);
+    }
+  }
+
+  [[nodiscard]] auto classify(const std::vector<std::string_view>& tags,
+                              const utility::regex& query,
+                              std::string_view query_pattern) -> match {
+    match result{.serial = true};
+    if (std::empty(tags)) {
+      return result;
+    }
+
+    const std::lock_guard lock{mutex_};
+    if (query_pattern != query_pattern_) {
+      query_pattern_ = query_pattern;
+      queried_.clear();
+      unqueried_.clear();
+    }
+
+    bits ids{};
+    for (const auto& tag : tags) {
+      const auto id = intern(tag);
+      ids.insert(id);
+      result.serial &= id == serial;
+      if (not std::empty(query_pattern) and not queried_.contains(id) and
+          not unqueried_.contains(id)) {
+        (query.match(tag) ? queried_ : unqueried_).insert(id);
+      }
+    }
+    result.skip = ids.contains(skip);
+    result.selected = ids.intersects(selected_);
+    result.queried = ids.intersects(queried_);
+    return result;
+  }
+
+  /// records `tags` for --list-tags
+  auto list(const std::vector<std::string_view>& tags) -> void {
+    const std::lock_guard lock{mutex_};
+    for (const auto& tag : tags) {
+      listed_.insert(intern(tag));
+    }
+  }
+
+  /// distinct listed tags, sorted
+  [[nodiscard]] auto listed() -> std::vector<std::string_view> {
+    const std::lock_guard lock{mutex_};
+    std::vector<std::string_view> tags{};
+    for (auto id = 0u; id < std::size(names_); ++id) {
+      if (listed_.contains(id)) {
+        tags.emplace_back(names_[id]);
+      }
+    }
+    std::sort(std::begin(tags), std::end(tags));
+    return tags;
+  }
+
+ private:
+  static constexpr std::size_t skip = 0;
+  static constexpr std::size_t serial = 1;
+
+  auto intern(std::string_view tag) -> std::size_t {
+    if (const auto it = ids_.find(tag); it != std::end(ids_)) {
+      return it->second;
+    }
+    const auto id = std::size(names_);
+    const auto& name = names_.emplace_back(tag);
+    ids_.emplace(name, id);
+    select(id);
+    return id;
+  }
+
+  auto select(std::size_t id) -> void {
+    for (const auto& pattern : patterns_) {
+      if (utility::is_match(names_[id], pattern)) {
+        selected_.insert(id);
+        return;
+      }
+    }
+  }
+
+  std::mutex mutex_{};
+  std::deque<std::string> names_{"skip", "serial"};
+  std::unordered_map<std::string_view, std::size_t> ids_{{names_[skip], skip},
+                                                         {names_[serial], serial}};
+  std::vector<std::string> patterns_{};
+  bits selected_{};
+  bits listed_{};
+  std::string query_pattern_{};
+  bits queried_{};
+  bits unqueried_{};
+};
+
+/// Work-stealing pool: every worker owns a deque of task indices which it
+/// drains from the front, idle workers steal from the back of the others.
+class thread_pool {
+ public:
+  explicit thread_pool(const std::size_t size) : queues_(size ? size : 1) {}
+
+  template <class TTask>
+  auto run(const std::size_t tasks, const TTask& task) -> void {
+    std::vector<std::size_t> order(tasks);
+    for (std::size_t i{}; i < tasks; ++i) {
+      order[i] = i;
+    }
+    run(order, task);
+  }
+
+  /// tasks are started in `order` (e.g. longest first) as far as possible
+  template <class TTask>
+  auto run(const std::vector<std::size_t>& order, const TTask& task) -> void {
+    for (std::size_t i{}; i < std::size(order); ++i) {
+      queues_[i % std::size(queues_)].tasks.push_back(order[i]);
+    }
+
+    std::vector<std::thread> workers{};
+    workers.reserve(std::size(queues_));
+    for (std::size_t worker{}; worker < std::size(queues_); ++worker) {
+      workers.emplace_back([this, worker, &task] {
+        while (const auto i = next(worker)) {
+          task(*i);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+ private:
+  struct worker_queue {
+    std::mutex mutex{};
+    std::deque<std::size_t> tasks{};
+  };
+
+  [[nodiscard]] auto next(const std::size_t worker)
+      -> std::optional<std::size_t> {
+    for (std::size_t n{}; n < std::size(queues_); ++n) {
+      auto& queue = queues_[(worker + n) % std::size(queues_)];
+      const std::scoped_lock lock{queue.mutex};
+      if (std::empty(queue.tasks)) {
+        continue;
+      }
+      const auto own = n == 0;
+      const auto i = own ? queue.tasks.front() : queue.tasks.back();
+      own ? queue.tasks.pop_front() : queue.tasks.pop_back();
+      return i;
+    }
+    return std::nullopt;
+  }
+
+  std::vector<worker_queue> queues_;
+};
+
+/// Watches the tests in progress from a thread of its own, which writes the
+/// message of the first one still running past its deadline to stderr and
+/// ends the process.
+/// N.B. only what `arm` published under the lock is touched on expiry
+class watchdog {
+ public:
+  watchdog() = default;
+  watchdog(const watchdog&) = delete;
+  auto operator=(const watchdog&) -> watchdog& = delete;
+  ~watchdog() {
+    {
+      const std::scoped_lock lock{state_->mutex};
+      state_->stopped = true;
+    }
+    state_->changed.notify_one();
+    if (thread_ and thread_->joinable()) {
+      thread_->join();
+    }
+  }
+
+  auto arm(void* id, const std::chrono::milliseconds timeout,
+           std::string message) -> void {
+    const std::scoped_lock lock{state_->mutex};
+    state_->deadlines.push_back({.id = id,
+                                 .at = std::chrono::steady_clock::now() + timeout,
+                                 .message = std::move(message)});
+    if (not thread_) {
+      thread_ = std::make_unique<std::thread>([this] { watch(); });
+    }
+    state_->changed.notify_one();
+  }
+
+  auto disarm(void* id) -> void {
+    const std::scoped_lock lock{state_->mutex};
+    std::erase_if(state_->deadlines,
+                  [id](const deadline& armed) { return armed.id == id; });
+  }
+
+  /// starts over in a forked child, where the thread of the parent process
+  /// does not exist and its state may be left locked, so both are leaked
+  auto reset() -> void {
+    static_cast<void>(thread_.release());
+    static_cast<void>(state_.release());
+    state_ = std::make_unique<state>();
+  }
+
+ private:
+  struct deadline {
+    void* id{};
+    std::chrono::steady_clock::time_point at{};
+    std::string message{};
+  };
+
+  struct state {
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    std::vector<deadline> deadlines{};
+    bool stopped{};
+  };
+
+  auto watch() -> void {
+    auto& watched = *state_;
+    std::unique_lock lock{watched.mutex};
+    while (not watched.stopped) {
+      if (std::empty(watched.deadlines)) {
+        watched.changed.wait(lock);
+        continue;
+      }
+      const auto first = std::min_element(
+          watched.deadlines.cbegin(), watched.deadlines.cend(),
+          [](const deadline& lhs, const deadline& rhs) { return lhs.at < rhs.at; });
+      if (std::chrono::steady_clock::now() < first->at) {
+        watched.changed.wait_until(lock, first->at);
+        continue;
+      }
+      expire(first->message);
+    }
+  }
+
+  [[noreturn]] static auto expire(std::string_view message) -> void {
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    while (not std::empty(message)) {
+      const auto n = ::write(STDERR_FILENO, message.data(), std::size(message));
+      if (n < 0 and errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      message.remove_prefix(static_cast<std::size_t>(n));
+    }
+#else
+    std::fwrite(message.data(), 1, std::size(message), stderr);
+    std::fflush(stderr);
+#endif
+    std::_Exit(-1);
+  }
+
+  std::unique_ptr<state> state_{std::make_unique<state>()};
+  std::unique_ptr<std::thread> thread_{};
+};
+
+[[nodiscard]] constexpr auto fnv1a(const std::string_view text,
+                                   std::uint64_t hash = 0xcbf29ce484222325ULL)
+    -> std::uint64_t {
+  for (const auto c : text) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// Position of a test in --order rand, it depends on the seed and the name
+/// only so that any subset of the tests is run in the same relative order.
+[[nodiscard]] constexpr auto shuffled(const std::string_view name,
+                                      const std::uint64_t seed) -> std::uint64_t {
+  auto key = fnv1a(name, 0xcbf29ce484222325ULL ^ seed);
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;  // splitmix64 finalizer
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  return key ^ (key >> 31);
+}
+
+/// Names of the tests to run, one per line of a file (-f, --input-file),
+/// kept in an open-addressing table of views into the mapped file.
+/// Empty lines and lines starting with '#' are ignored.
+class name_set {
+ public:
+  explicit name_set(const std::string& filename) : file_{filename} {
+    const auto text = file_.data();
+    const auto lines = std::count(text.begin(), text.end(), '\n') + 1;
+    slots_.resize(std::bit_ceil(2 * static_cast<std::size_t>(lines)));
+    for (auto rest = text; not std::empty(rest);) {
+      const auto eol = std::min(rest.find('\n'), std::size(rest));
+      auto name = rest.substr(0, eol);
+      rest.remove_prefix(std::min(eol + 1, std::size(rest)));
+      if (not std::empty(name) and name.back() == '\r') {
+        name.remove_suffix(1);
+      }
+      if (std::empty(name) or name.front() == '#') {
+        continue;
+      }
+      if (auto& slot = slots_[find(name)]; slot.data() == nullptr) {
+        slot = name;
+        ++size_;
+      }
+    }
+  }
+
+  [[nodiscard]] auto contains(const std::string_view name) const -> bool {
+    return slots_[find(name)].data() != nullptr;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return size_; }
+
+ private:
+  /// slot of `name`, or the empty one where it would be (linear probing)
+  [[nodiscard]] auto find(const std::string_view name) const -> std::size_t {
+    const auto mask = std::size(slots_) - 1;
+    for (auto i = static_cast<std::size_t>(fnv1a(name)) & mask;;
+         i = (i + 1) & mask) {
+      if (slots_[i].data() == nullptr or slots_[i] == name) {
+        return i;
+      }
+    }
+  }
+
+  mapped_file file_;
+  std::vector<std::string_view> slots_{};  /// empty: data() == nullptr
+  std::size_t size_{};
+};
+
+/// key of a top-level test in the files of previous runs
+[[nodiscard]] inline auto test_path(std::string_view suite, std::string_view test)
+    -> std::string {
+  std::string path{};
+  path.reserve(std::size(suite) + 1 + std::size(test));
+  path.append(suite).append(1, '\t').append(test);
+  return path;
+}
+
+/// Outcome and duration of the top-level tests of the previous runs
+/// (--cache-dir), in a file per executable (or --cache-key) with one line
+/// per test: <failed 0|1> <duration ns> <suite>\t<test>
+/// Tests which are not run again keep their previous line.
+class result_cache {
+ public:
+  struct result {
+    bool failed{};
+    std::int64_t duration_ns{};
+  };
+
+  explicit result_cache(const std::string& directory, std::string_view key)
+      : filename_{directory + "/ut-" + hex(fnv1a(key)) + ".cache"},
+        file_{filename_} {
+    for (auto rest = file_.data(); not std::empty(rest);) {
+      const auto eol = std::min(rest.find('\n'), std::size(rest));
+      auto line = rest.substr(0, eol);
+      rest.remove_prefix(std::min(eol + 1, std::size(rest)));
+
+      result cached{.failed = line.starts_with('1')};
+      const auto space = line.find(' ', 2);
+      if (std::size(line) < 2 or space == std::string_view::npos or
+          std::from_chars(line.data() + 2, line.data() + space,
+                          cached.duration_ns)
+                  .ec != std::errc{}) {
+        continue;
+      }
+      const auto path = line.substr(space + 1);
+      previous_[path] = cached;
+      suites_[path.substr(0, path.find('\t'))] += cached.duration_ns;
+    }
+#if __has_include(<sys/stat.h>)
+    ::mkdir(directory.c_str(), 0777);  // N.B. may already exist
+#endif
+  }
+
+  [[nodiscard]] auto find(std::string_view suite, std::string_view test) const
+      -> const result* {
+    const auto it = previous_.find(test_path(suite, test));
+    return it != std::end(previous_) ? &it->second : nullptr;
+  }
+
+  /// of all the tests of the suite, to schedule it
+  [[nodiscard]] auto duration_ns(std::string_view suite) const -> std::int64_t {
+    const auto it = suites_.find(suite);
+    return it != std::end(suites_) ? it->second : 0;
+  }
+
+  /// thread safe, a test failing any of its runs stays failed
+  auto record(std::string_view suite, std::string_view test, bool failed,
+              std::chrono::nanoseconds duration) -> void {
+    const std::scoped_lock lock{mutex_};
+    auto& recorded = recorded_[test_path(suite, test)];
+    recorded.failed = recorded.failed or failed;
+    recorded.duration_ns = duration.count();
+  }
+
+  /// writes a new file, which replaces the previous one once complete
+  auto save() -> void {
+    const std::scoped_lock lock{mutex_};
+    const auto temporary = filename_ + ".tmp";
+    {
+      std::ofstream out{temporary, std::ios::binary};
+      for (const auto& [test, cached] : previous_) {
+        if (not recorded_.contains(std::string{test})) {
+          write(out, test, cached);
+        }
+      }
+      for (const auto& [test, recorded] : recorded_) {
+        write(out, test, recorded);
+      }
+      if (not out) {
+        return;
+      }
     }
+    std::rename(temporary.c_str(), filename_.c_str());
   }
 
-  auto on(events::summary) -> void {
-    std::cout.flush();
-    std::cout.rdbuf(cout_save);
-    std::ofstream maybe_of;
-    if (detail::cfg::output_filename != "") {
-      maybe_of = std::ofstream(detail::cfg::output_filename);
-    }
+ private:
+  [[nodiscard]] static auto hex(const std::uint64_t value) -> std::string {
+    std::array<char, 16> text{};
+    const auto [end, ec] = std::to_chars(text.data(), text.data() + std::size(text),
+                                         value, 16);
+    return {text.data(), end};
+  }
 
-    if (report_type_ == JUNIT) {
-      print_junit_summary(detail::cfg::output_filename != "" ? maybe_of
-                                                             : std::cout);
-      return;
+  static auto write(std::ostream& out, std::string_view test, const result& cached)
+      -> void {
+    out << (cached.failed ? '1' : '0') << ' ' << cached.duration_ns << ' '
+        << test << '\n';
+  }
+
+  std::string filename_;
+  mapped_file file_;
+  std::unordered_map<std::string_view, result> previous_{};
+  std::unordered_map<std::string_view, std::int64_t> suites_{};
+  std::unordered_map<std::string, result> recorded_{};
+  std::mutex mutex_{};
+};
+
+/// Durations of the top-level tests of a previous run (--durations-from),
+/// read from a JUnit report or a binlog, to schedule the longest tests first
+/// and to balance the shards by time.
+/// The tests with a history are assigned to the least loaded of `shards`,
+/// longest first, the others are sharded by count.
+class duration_history {
+ public:
+  explicit duration_history(const std::string& filename,
+                            const std::size_t shards) {
+    const mapped_file file{filename};
+    const auto data = file.data();
+    const auto first = data.find_first_not_of(" \t\r\n");
+    if (first != std::string_view::npos and data[first] == '<') {
+      read_junit(data);
+    } else {
+      read_binlog(data);
     }
-    lcout_ << ss_out_.str();
-    print_console_summary(
-        detail::cfg::output_filename != "" ? maybe_of : std::cout,
-        detail::cfg::output_filename != "" ? maybe_of : std::cerr);
+    assign(shards);
   }
 
- protected:
-  inline double get_duration(test_result* test_node) const {
-    std::int64_t time_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            test_node->run_stop - test_node->run_start)
-            .count();
-    return static_cast<double>(time_ms) / 1000.0;
+  [[nodiscard]] auto duration_ns(std::string_view suite,
+                                 std::string_view test) const -> std::int64_t {
+    const auto it = tests_.find(test_path(suite, test));
+    return it != std::end(tests_) ? it->second.duration_ns : 0;
   }
 
-  inline void print_duration(auto& printer) const noexcept {
-    if (detail::cfg::show_duration) {
-      printer << "after " << get_duration(current_node_) << " seconds ";
-    }
+  [[nodiscard]] auto duration_ns(std::string_view suite) const -> std::int64_t {
+    const auto it = suites_.find(std::string{suite});
+    return it != std::end(suites_) ? it->second : 0;
   }
 
-  void print_console_summary(std::ostream& out_stream,
-                             std::ostream& err_stream) {
-    for (const auto& suite_result : suites_results_) {
-      if (suite_result->fails) {
-        err_stream
-            << "\n========================================================"
-               "=======================\n"
-            << "Suite " << suite_result->test_name << '\n'
-            << "tests:   " << (suite_result->n_tests) << " | "
-            << (suite_result->fail_tests > 0 ? color_.fail : color_.none)
-            << suite_result->fail_tests << " failed" << color_.none << '\n'
-            << "asserts: " << (suite_result->assertions) << " | "
-            << (suite_result->assertions - suite_result->fails) << " passed"
-            << " | " << color_.fail << suite_result->fails << " failed"
-            << color_.none;
-      } else if (suite_result->assertions || suite_result->n_tests ||
-                 suite_result->skipped) {
-        out_stream
-            << color_.pass << "\nSuite '" << suite_result->test_name
-            << "': all tests passed" << color_.none << " ("
-            << suite_result->assertions << " asserts in "
-            << suite_result->n_tests << " tests)";
+  [[nodiscard]] auto shard(std::string_view suite, std::string_view test) const
+      -> std::optional<std::size_t> {
+    const auto it = tests_.find(test_path(suite, test));
+    return it != std::end(tests_) ? std::optional{it->second.shard}
+                                  : std::nullopt;
+  }
+
+ private:
+  struct timed {
+    std::int64_t duration_ns{};
+    std::size_t shard{};
+  };
+
+  auto add(std::string_view suite, std::string_view name,
+           const std::int64_t duration_ns) -> void {
+    tests_[test_path(suite, name)].duration_ns += duration_ns;
+    suites_[std::string{suite}] += duration_ns;
+  }
+
+  /// top-level <testcase classname="suite" name="test" time="seconds">
+  auto read_junit(std::string_view xml) -> void {
+    std::size_t depth{};
+    for (auto pos = xml.find('<'); pos != std::string_view::npos;
+         pos = xml.find('<', pos + 1)) {
+      if (xml.substr(pos).starts_with("</testcase>")) {
+        depth -= depth ? 1 : 0;
+        continue;
       }
-      if (suite_result->skipped) {
-        std::cout << "; " << color_.skip << suite_result->skipped
-                  << " tests skipped" << color_.none;
+      if (not xml.substr(pos).starts_with("<testcase ")) {
+        continue;
       }
-      std::cout.flush();
+      const auto end = xml.find('>', pos);
+      if (end == std::string_view::npos) {
+        return;
+      }
+      const auto element = xml.substr(pos, end - pos);
+      if (not depth) {
+        auto seconds = 0.0;
+        const auto time = attribute(element, "time");
+        std::from_chars(time.data(), time.data() + std::size(time), seconds);
+        add(unescaped(attribute(element, "classname")),
+            unescaped(attribute(element, "name")),
+            static_cast<std::int64_t>(seconds * 1e9));
+      }
+      depth += element.ends_with('/') ? 0 : 1;
     }
   }
 
-  void print_junit_summary(std::ostream& stream) {
-    // aggregate results
-    size_t n_tests = 0;
-    size_t n_fails = 0;
-    double total_time = 0.0;
-    for (const auto& suite_result : suites_results_) {
-      n_tests += suite_result->assertions;
-      n_fails += suite_result->fails;
-      total_time += get_duration(suite_result.get());
+  [[nodiscard]] static auto attribute(std::string_view element,
+                                      std::string_view name) -> std::string_view {
+    for (auto pos = element.find(name); pos != std::string_view::npos;
+         pos = element.find(name, pos + 1)) {
+      const auto value = element.substr(pos + std::size(name));
+      if (element[pos - 1] == ' ' and value.starts_with("=\"")) {
+        return value.substr(2, value.find('"', 2) - 2);
+      }
     }
+    return {};
+  }
 
-    // mock junit output:
-    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-    stream << "<testsuites";
-    stream << " name=\"all\"";
-    stream << " tests=\"" << n_tests << '\"';
-    stream << " failures=\"" << n_fails << '\"';
-    stream << " time=\"" << total_time << '\"';
-    stream << ">\n";
-
-    for (const auto& suite_result : suites_results_) {
-      stream << "<testsuite";
-      stream << " classname=\"" << detail::cfg::executable_name << '\"';
-      stream << " name=\"" << suite_result->test_name << '\"';
-      stream << " tests=\"" << suite_result->assertions << '\"';
-      stream << " errors=\"" << suite_result->fails << '\"';
-      stream << " failures=\"" << suite_result->fails << '\"';
-      stream << " skipped=\"" << suite_result->skipped << '\"';
-      stream << " time=\"" << get_duration(suite_result.get()) << '\"';
-      stream << " version=\"" << BOOST_UT_VERSION << "\">\n";
-      print_result(stream, suite_result->test_name, " ", *suite_result);
-      stream << "</testsuite>\n";
-      stream.flush();
+  [[nodiscard]] static auto unescaped(std::string_view text) -> std::string {
+    std::string result{};
+    while (not std::empty(text)) {
+      const auto amp = std::min(text.find('&'), std::size(text));
+      result.append(text.substr(0, amp));
+      text.remove_prefix(amp);
+      if (std::empty(text)) {
+        break;
+      }
+      constexpr std::pair<std::string_view, char> entities[] = {
+          {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'},
+          {"&apos;", '\''}};
+      auto length = std::size_t{1};
+      auto c = '&';
+      for (const auto& [entity, character] : entities) {
+        if (text.starts_with(entity)) {
+          length = std::size(entity);
+          c = character;
+        }
+      }
+      result += c;
+      text.remove_prefix(length);
     }
-    stream << "</testsuites>";
-  }
-  void print_result(std::ostream& stream, const std::string& suite_name,
-                    const std::string& indent, const test_result& test_node) {
-    for (const auto& child_result : test_node.children) {
-      stream << indent;
-      stream << "<testcase classname=\"" << suite_name << '\"';
-      stream << " name=\"" << child_result->test_name << '\"';
-      stream << " tests=\"" << child_result->assertions << '\"';
-      stream << " errors=\"" << child_result->fails << '\"';
-      stream << " failures=\"" << child_result->fails << '\"';
-      stream << " skipped=\"" << child_result->skipped << '\"';
-      stream << " time=\"" << get_duration(child_result.get()) << "\"";
-      stream << " status=\"" << statusStrings[(int)child_result->status]
-             << '\"';
-      if (child_result->report_string.empty() &&
-          child_result->children.empty()) {
-        stream << " />\n";
-      } else if (!child_result->children.empty()) {
-        stream << " />\n";
-        print_result(stream, suite_name, indent + "  ", *child_result);
-        stream << indent << "</testcase>\n";
-      } else if (!child_result->report_string.empty()) {
-        stream << ">\n";
-        stream << indent << indent << "<system-out>\n";
-        stream << child_result->report_string << "\n";
-        stream << indent << indent << "</system-out>\n";
-        stream << indent << "</testcase>\n";
+    return result;
+  }
+
+  /// top-level tests between test_begin and test_end
+  auto read_binlog(std::string_view data) -> void {
+    struct collector {
+      duration_history* history{};
+      std::string_view suite{"global"};
+      clock::time_point start{};
+
+      auto on(const events::suite_begin& event) -> void { suite = event.name; }
+      auto on(const events::suite_end&) -> void { suite = "global"; }
+      auto on(const events::test_begin&) -> void { start = clock::now(); }
+      auto on(const events::test_end& event) -> void {
+        history->add(suite, event.name,
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         clock::now() - start)
+                         .count());
       }
+    } collect{.history = this};
+    recording::replay(data, collect);
+  }
+
+  /// longest first to the least loaded shard, ties by name
+  auto assign(const std::size_t shards) -> void {
+    std::vector<std::pair<const std::string*, timed*>> longest{};
+    longest.reserve(std::size(tests_));
+    for (auto& [path, history] : tests_) {
+      longest.emplace_back(&path, &history);
+    }
+    std::sort(longest.begin(), longest.end(), [](const auto& lhs, const auto& rhs) {
+      return lhs.second->duration_ns != rhs.second->duration_ns
+                 ? lhs.second->duration_ns > rhs.second->duration_ns
+                 : *lhs.first < *rhs.first;
+    });
+    std::vector<std::int64_t> loads(shards ? shards : 1);
+    for (auto& [path, history] : longest) {
+      const auto least = std::min_element(loads.begin(), loads.end());
+      history->shard = static_cast<std::size_t>(least - loads.begin());
+      *least += history->duration_ns;
     }
   }
+
+  std::unordered_map<std::string, timed> tests_{};
+  std::unordered_map<std::string, std::int64_t> suites_{};
 };
+}  // namespace detail
 
 struct options {
   std::string_view filter{};
@@ -1990,91 +4830,358 @@ class runner {
     constexpr /*explicit(false)*/ filter(std::string_view _filter = {})
         : path_{utility::split(_filter, delim)} {}
 
-    template <class TPath>
-    constexpr auto operator()(const std::size_t level, const TPath& path) const
-        -> bool {
-      for (auto i = 0u; i < math::min_value(level + 1, std::size(path_)); ++i) {
-        if (not utility::is_match(path[i], path_[i])) {
-          return false;
+    template <class TPath>
+    constexpr auto operator()(const std::size_t level, const TPath& path) const
+        -> bool {
+      for (auto i = 0u; i < math::min_value(level + 1, std::size(path_)); ++i) {
+        if (not utility::is_match(path[i], path_[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+   private:
+    std::vector<std::string_view> path_{};
+  };
+
+ public:
+  constexpr runner() {
+    owner_ = true;
+    std::cout << "UT starts ========================================================"
+                 "=============";
+  };
+  constexpr runner(TReporter reporter, std::size_t suites_size)
+      : reporter_{std::move(reporter)}, suites_(suites_size) {
+    owner_ = true;
+  }
+
+  ~runner() {
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    if (child_ >= 0) {  // a forked test called std::exit
+      if (worker_) {
+        flush_child();
+      }
+      return;
+    }
+#endif
+
+    const auto should_run = not run_;
+    if (should_run) {
+      static_cast<void>(run());
+    }
+
+    if (not dry_run_) {
+      report_summary();
+    }
+    std::cout << "\nCompleted =============================================="
+                 "=======================\n";
+    if (should_run and fails_) {
+      std::exit(-1);
+    }
+  }
+
+  auto operator=(const options& options) {
+    filter_ = options.filter;
+    tags_.filter(options.tag);
+    dry_run_ = options.dry_run;
+    reporter_ = {options.colors};
+  }
+
+  template <class TSuite>
+  auto on(events::suite<TSuite> suite) {
+    suites_.emplace_back(suite.run, suite.name);
+  }
+
+  template <class... Ts>
+  auto on(events::test<Ts...> test) -> void {
+    if (worker_ ? worker_->level : level_) {  // nested tests are run inline
+      run_test(std::move(test));
+      return;
+    }
+
+    auto& suite = body();
+    if (suite.counting) {  // see `run_suite`
+      ++suite.ordinal;
+      return;
+    }
+    const auto last = ++suite.ordinal == suite.tests;
+    if (admitted(test.name)) {
+      if (ordered() and suite.suite) {  // run in order once all registered
+        auto name = test.name;
+        plan().push_back(
+            planned{.name = std::move(name),
+                    .run = [this, test = std::move(test)]() mutable {
+                      dispatch(std::move(test));
+                    }});
+      } else {
+        dispatch(std::move(test));
+      }
+    }
+    if (last) {  // runs the deferred tests while the body is still alive
+      run_deferred();
+    }
+  }
+
+  template <class... Ts>
+  auto dispatch(events::test<Ts...> test) -> void {
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    if (detail::cfg::fork_jobs and not worker_ and not listing()) {
+      spawn(std::move(test));  // repeated by the child
+      return;
+    }
+#endif
+
+    if (repeating() and not listing()) {
+      repeat(std::move(test));
+      return;
+    }
+
+    if (parallel()) {
+      const auto serial =
+          std::find(test.tag.cbegin(), test.tag.cend(), "serial") !=
+          test.tag.cend();
+      const auto expected = expected_ns(suite_name(), test.name);
+      tasks_.push_back(
+          task{.run = [this, suite = body_.suite,
+                       test = std::move(test)]() mutable {
+                 worker_->body.suite = suite;
+                 run_test(std::move(test));
+               },
+               .serial = serial,
+               .expected_ns = expected});
+      return;
+    }
+
+    run_test(std::move(test));
+  }
+
+  template <class... Ts>
+  auto on(events::skip<Ts...> test) {
+    if (not body().counting) {
+      report(events::test_skip{.type = test.type, .name = test.name});
+    }
+  }
+
+  template <class TExpr>
+  [[nodiscard]] auto on(events::assertion<TExpr> assertion) -> bool {
+    if (dry_run_) {
+      return true;
+    }
+
+    if (foreign()) {
+      if (static_cast<bool>(assertion.expr)) {
+        channel_.pass();
+        return true;
+      }
+      channel_.fail(assertion.expr, assertion.location);
+      return false;
+    }
+
+    if (body().counting) {  // reported by the pass which runs the tests
+      return static_cast<bool>(assertion.expr);
+    }
+
+    if (static_cast<bool>(assertion.expr)) {
+      if constexpr (counting) {  // reported in batches
+        ++passed();
+      } else {
+        report(events::assertion_pass<TExpr>{.expr = assertion.expr,
+                                             .location = assertion.location});
+      }
+      return true;
+    }
+
+    ++fails();
+    report(events::assertion_fail<TExpr>{.expr = assertion.expr,
+                                         .location = assertion.location});
+    return false;
+  }
+
+  auto on(events::fatal_assertion fatal_assertion) {
+    if (foreign()) {  // the summary will include the failure
+      std::exit(-1);
+    }
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    if (child_ >= 0) {  // fails the forked test only
+      flush_passed();
+      worker_->recording.on(fatal_assertion);
+      flush_child();
+      std::_Exit(-1);
+    }
+#endif
+    flush_passed();
+    if (worker_) {  // flush what has been recorded so far and bail out
+      worker_->recording.on(fatal_assertion);
+      auto lock = schedule_ ? std::unique_lock{schedule_->mutex}
+                            : std::unique_lock<std::mutex>{};
+      if (schedule_) {
+        replay_completed();
+      }
+      worker_->recording.replay(reporter_);
+      fails_ += worker_->fails;
+      report_summary();
+      std::cout << "\nCompleted =============================================="
+                   "=======================\n"
+                << std::flush;
+      std::_Exit(-1);
+    }
+    reporter_.on(fatal_assertion);
+    std::exit(-1);
+  }
+
+  template <class TMsg>
+  auto on(events::log<TMsg> l) {
+    if (foreign()) {
+      channel_.log(l.msg);
+      return;
+    }
+    if (not body().counting) {
+      report(l);
+    }
+  }
+
+  [[nodiscard]] auto run(run_cfg rc = {}) -> bool {
+    run_ = true;
+    reporter_.on(events::run_begin{.argc = rc.argc, .argv = rc.argv});
+    if (detail::cfg::input_filename != "") {
+      selection_.emplace(detail::cfg::input_filename);
+    }
+    if (detail::cfg::cache_dir != "" and not listing()) {
+      load_cache();
+    }
+    if (detail::cfg::durations_from != "") {
+      history_.emplace(detail::cfg::durations_from, detail::cfg::shard().second);
+    }
+    if (detail::cfg::sort_order == "rand") {
+      if (not detail::cfg::rnd_seed) {
+        detail::cfg::rnd_seed = static_cast<std::size_t>(
+            std::chrono::system_clock::now().time_since_epoch().count());
+      }
+      std::cerr << "Randomness seeded to: " << detail::cfg::rnd_seed
+                << std::endl;
+    }
+    if (const auto* status_file = std::getenv("GTEST_SHARD_STATUS_FILE")) {
+      std::ofstream touch{status_file};  // sharding is supported
+    }
+    reap_children();  // forked before `run`, reported once configured
+
+    if (detail::cfg::replay_filename != "") {  // reports a binlog instead
+      const detail::mapped_file binlog{detail::cfg::replay_filename};
+      detail::recording::replay(binlog.data(), reporter_);
+      fails_ += detail::recording::scan(binlog.data()).fails;
+      suites_.clear();
+      if (rc.report_errors) {
+        report_summary();
+      }
+      return fails_ > 0;
+    }
+
+    if (concurrency() > 1 and std::size(suites_) > 1 and
+        not detail::cfg::parallel_tests and not detail::cfg::fork_jobs) {
+      for (auto i = 0u; i < std::size(suites_); ++i) {
+        tasks_.push_back(task{
+            .run =
+                [this, i, suite_name = suites_[i].second] {
+                  report(events::suite_begin{.type = "suite", .name = suite_name});
+                  run_suite(i + 1);
+                  report(events::suite_end{.type = "suite", .name = suite_name});
+                },
+            .expected_ns = expected_ns(suites_[i].second)});
+      }
+      run_tasks();
+    } else {
+      for (auto i = 0u; i < std::size(suites_); ++i) {
+        const auto& suite_name = suites_[i].second;
+        // add reporter in/out
+        if constexpr (requires { reporter_.on(events::suite_begin{}); }) {
+          reporter_.on(
+              events::suite_begin{.type = "suite", .name = suite_name});
+        }
+        run_suite(i + 1);
+        flush_passed();
+        if constexpr (requires { reporter_.on(events::suite_end{}); }) {
+          reporter_.on(events::suite_end{.type = "suite", .name = suite_name});
         }
       }
-      return true;
+    }
+    suites_.clear();
+    if (cache_) {
+      cache_->save();
     }
 
-   private:
-    std::vector<std::string_view> path_{};
-  };
-
- public:
-  constexpr runner() {
-    std::cout << "UT starts ========================================================"
-                 "=============";
-  };
-  constexpr runner(TReporter reporter, std::size_t suites_size)
-      : reporter_{std::move(reporter)}, suites_(suites_size) {}
-
-  ~runner() {
-    const auto should_run = not run_;
-    if (should_run) {
-      static_cast<void>(run());
+    if (detail::cfg::list_tags) {
+      for (const auto& tag : tags_.listed()) {
+        std::cout << "tag: " << tag << std::endl;
+      }
     }
 
-    if (not dry_run_) {
+    if (rc.report_errors) {
       report_summary();
     }
-    std::cout << "\nCompleted =============================================="
-                 "=======================\n";
-    if (should_run and fails_) {
-      std::exit(-1);
-    }
-  }
 
-  auto operator=(const options& options) {
-    filter_ = options.filter;
-    tag_ = options.tag;
-    dry_run_ = options.dry_run;
-    reporter_ = {options.colors};
+    return fails_ > 0;
   }
 
-  template <class TSuite>
-  auto on(events::suite<TSuite> suite) {
-    suites_.emplace_back(suite.run, suite.name);
+  auto report_summary() -> void {
+    if (static auto once = true; once) {
+      once = false;
+      drain();
+      flush_passed();
+      reporter_.on(events::summary{});
+    }
   }
 
+ protected:
+  /// top-level test registered to be run in --order (see `run_plan`)
+  struct planned {
+    std::string name{};
+    std::uint64_t key{};  /// sort key of --order rand
+    utility::function<void()> run;
+  };
+
+  /// the suite body being run and the top-level tests it registered
+  struct suite_body {
+    std::size_t suite{};    /// index in `suites_` + 1, 0: none
+    std::size_t ordinal{};  /// of the last top-level test registered
+    std::size_t tests{};    /// registered by the counting pass, 0: unknown
+    bool counting{};        /// the tests are counted rather than run
+  };
+
+  /// state of the suite being run by a worker thread
+  struct worker {
+    std::size_t level{};
+    std::array<std::string_view, MaxPathSize> path{};
+    std::size_t fails{};
+    std::size_t passed{};
+    suite_body body{};
+    detail::recording recording{};
+    std::vector<planned> plan{};
+  };
+
   template <class... Ts>
-  auto on(events::test<Ts...> test) {
-    path_[level_] = test.name;
+  auto run_test(events::test<Ts...> test) -> void {
+    auto& level = worker_ ? worker_->level : level_;
+    auto& path = worker_ ? worker_->path : path_;
+    path[level] = test.name;
 
-    if (detail::cfg::list_tags) {
-      std::for_each(test.tag.cbegin(), test.tag.cend(), [](const auto& tag) {
-        std::cout << "tag: " << tag << std::endl;
-      });
+    if (detail::cfg::list_tags) {  // printed, once each, by `run`
+      tags_.list(test.tag);
       return;
     }
 
-    auto execute = std::empty(test.tag);
-    for (const auto& tag_element : test.tag) {
-      if (utility::is_match(tag_element, "skip") && !detail::cfg::show_tests &&
-          !detail::cfg::show_test_names) {
-        on(events::skip<>{.type = test.type, .name = test.name});
-        return;
-      }
-
-      for (const auto& ftag : tag_) {
-        if (utility::is_match(tag_element, ftag)) {
-          execute = true;
-          break;
-        }
-      }
+    const auto tags = tags_.classify(test.tag, detail::cfg::query_regex,
+                                     detail::cfg::query_pattern);
+    if (tags.skip && !detail::cfg::show_tests &&
+        !detail::cfg::show_test_names) {
+      on(events::skip<>{.type = test.type, .name = test.name});
+      return;
     }
+    // "serial" only affects scheduling
+    auto execute = tags.serial or tags.selected;
 
     if (!detail::cfg::query_pattern.empty()) {
-      const static auto regex = detail::cfg::query_regex_pattern;
-      bool matches = utility::regex_match(test.name.data(), regex.c_str());
-      for (const auto& tag2 : test.tag) {
-        matches |= utility::regex_match(tag2.data(), regex.c_str());
-      }
-      if (matches) {
+      if (tags.queried or detail::cfg::query_regex.match(test.name)) {
         execute = !detail::cfg::invert_query_pattern;
       } else {
         execute = detail::cfg::invert_query_pattern;
@@ -2082,10 +5189,12 @@ class runner {
     }
 
     if (detail::cfg::show_tests || detail::cfg::show_test_names) {
-      if (!detail::cfg::show_test_names) {
-        std::cout << "matching test: ";
+      if (detail::cfg::query_pattern.empty() or execute) {
+        if (!detail::cfg::show_test_names) {
+          std::cout << "matching test: ";
+        }
+        std::cout << test.name << std::endl;
       }
-      std::cout << test.name << std::endl;
       return;
     }
 
@@ -2094,110 +5203,612 @@ class runner {
       return;
     }
 
-    if (filter_(level_, path_)) {
-      if (not level_++) {
-        reporter_.on(events::test_begin{
+    if (filter_(level, path)) {
+      if (not level++) {
+        report(events::test_begin{
             .type = test.type, .name = test.name, .location = test.location});
       } else {
-        reporter_.on(events::test_run{.type = test.type, .name = test.name});
+        report(events::test_run{.type = test.type, .name = test.name});
       }
 
       if (dry_run_) {
-        for (auto i = 0u; i < level_; ++i) {
-          std::cout << (i ? "." : "") << path_[i];
+        for (auto i = 0u; i < level; ++i) {
+          std::cout << (i ? "." : "") << path[i];
         }
         std::cout << '\n';
       }
 
+      const auto timeout =
+          level > 1 ? std::chrono::milliseconds{}
+          : test.timeout.count()
+              ? test.timeout
+              : std::chrono::milliseconds{detail::cfg::timeout_ms};
+      if (timeout.count() and not dry_run_) {
+        auto message = "\ntimed out after " + std::to_string(timeout.count()) +
+                       " ms:";
+        for (auto i = 0u; i < level; ++i) {
+          message += i ? '.' : ' ';
+          message += path[i];
+        }
+        watchdog_.arm(worker_, timeout, std::move(message) + '\n');
+      }
+      const auto start = std::chrono::steady_clock::now();
+      const auto previous_fails = fails();
+
 #if defined(__cpp_exceptions)
       try {
         test();
       } catch (const std::exception& exception) {
-        ++fails_;
-        reporter_.on(events::exception{exception.what()});
+        ++fails();
+        report(events::exception{exception.what()});
       } catch (...) {
-        ++fails_;
-        reporter_.on(events::exception{"Unknown exception"});
+        ++fails();
+        report(events::exception{"Unknown exception"});
       }
 #endif
 
-      if (not--level_) {
-        reporter_.on(events::test_end{.type = test.type, .name = test.name});
+      if (timeout.count() and not dry_run_) {
+        watchdog_.disarm(worker_);
+      }
+      drain();
+      if (cache_ and level == 1) {
+        cache_->record(suite_name(), test.name, fails() > previous_fails,
+                       std::chrono::steady_clock::now() - start);
+      }
+      if (not--level) {
+        report(events::test_end{.type = test.type, .name = test.name});
       } else {  // N.B. prev. only root-level tests were signalled on finish
-        if constexpr (requires {
-                        reporter_.on(events::test_finish{.type = test.type,
-                                                         .name = test.name});
-                      }) {
-          reporter_.on(
-              events::test_finish{.type = test.type, .name = test.name});
+        report(events::test_finish{.type = test.type, .name = test.name});
+      }
+    }
+  }
+
+
+  /// suite or top-level test to be run by the thread pool
+  struct task {
+    utility::function<void()> run;
+    bool serial{};  /// pinned to the main thread
+    std::int64_t expected_ns{};  /// cached duration, longest are started first
+  };
+
+  /// tasks run by the thread pool, replayed in declaration order
+  struct schedule {
+    std::vector<worker> workers{};
+    std::vector<bool> done{};
+    std::size_t replayed{};
+    std::mutex mutex{};
+  };
+
+  /// reporter only counts passed assertions (see events::assertions_passed)
+  static constexpr auto counting =
+      requires(TReporter reporter) { reporter.on(events::assertions_passed{}); };
+
+  template <class TEvent>
+  auto report(const TEvent& event) -> void {
+    flush_passed();
+    if (worker_) {
+      worker_->recording.on(event);
+    } else if constexpr (requires { reporter_.on(event); }) {
+      reporter_.on(event);
+    }
+  }
+
+  [[nodiscard]] auto fails() -> std::size_t& {
+    return worker_ ? worker_->fails : fails_;
+  }
+
+  [[nodiscard]] auto passed() -> std::size_t& {
+    return worker_ ? worker_->passed : passed_;
+  }
+
+  /// reports passed assertions counted since the last event
+  auto flush_passed() -> void {
+    if constexpr (counting) {
+      if (const auto count = std::exchange(passed(), 0)) {
+        if (worker_) {
+          worker_->recording.on(events::assertions_passed{.count = count});
+        } else {
+          reporter_.on(events::assertions_passed{.count = count});
         }
       }
     }
   }
 
+  /// called from a thread spawned by a test rather than the one running it
+  [[nodiscard]] auto foreign() const -> bool {
+    return not worker_ and not owner_;
+  }
+
+  /// reports what threads spawned by tests have asserted so far
+  /// N.B. while tasks run concurrently it is unknown which task spawned the
+  /// thread, so those are reported once the thread pool is done
+  auto drain() -> void {
+    if (worker_ and schedule_) {
+      return;
+    }
+    channel_.drain(
+        [this](const std::size_t passes) {
+          if constexpr (counting) {
+            passed() += passes;
+          } else {
+            for (std::size_t i{}; i < passes; ++i) {
+              report(
+                  events::assertion_pass<bool>{.expr = true, .location = {}});
+            }
+          }
+        },
+        [this](const detail::channel::message& message) {
+          if (message.log) {
+            report(events::log<std::string_view>{.msg = message.text});
+            return;
+          }
+          ++fails();
+          report(events::assertion_fail<detail::formatted_expr>{
+              .expr = {.text = message.text}, .location = message.location});
+        });
+  }
+
+  /// top-level tests of a suite are registered first and then run in
+  /// --order lex|rand, those declared outside of suites run right away
+  [[nodiscard]] auto ordered() const -> bool {
+    return detail::cfg::sort_order == "lex" or
+           detail::cfg::sort_order == "rand" or
+           (detail::cfg::failed_first and cache_) or
+           (detail::cfg::fork_jobs and (cache_ or history_));
+  }
+
+  [[nodiscard]] auto plan() -> std::vector<planned>& {
+    return worker_ ? worker_->plan : plan_;
+  }
+
+  [[nodiscard]] auto body() -> suite_body& {
+    return worker_ ? worker_->body : body_;
+  }
+
+  /// runs the body of the suite with this index (+ 1)
+  /// N.B. deferred top-level tests may reference locals of the body, so they
+  /// are run when the last one registers rather than once the body returned;
+  /// the body is run one more time before, to count them
+  auto run_suite(const std::size_t suite) -> void {
+    const auto run_body = suites_[suite - 1].first;
+    body() = {.suite = suite};
+    if (deferring()) {
+      body().counting = true;
+      run_body();
+      body() = {.suite = suite, .tests = body().ordinal};
+    }
+    run_body();
+    run_deferred();  // the body registered fewer tests than counted
+    reap_children();
+    body() = {};
+  }
+
+  /// top-level tests of suite bodies are deferred until all are registered
+  [[nodiscard]] auto deferring() const -> bool {
+    return ordered() or parallel();
+  }
+
+  auto run_deferred() -> void {
+    run_plan();
+    run_tasks();
+  }
+
+  /// top-level tests of suite bodies run on the thread pool (--parallel-tests)
+  [[nodiscard]] auto parallel() const -> bool {
+    return detail::cfg::parallel_tests and not worker_ and body_.suite and
+           concurrency() > 1;
+  }
+
+  /// whether the top-level test is selected to run
+  [[nodiscard]] auto admitted(std::string_view name) -> bool {
+    if (selection_ and not selection_->contains(name)) {  // --input-file
+      return false;
+    }
+    if (detail::cfg::only_failed and cache_) {
+      if (const auto* cached = cache_->find(suite_name(), name);
+          cached and not cached->failed) {
+        return false;
+      }
+    }
+    return sharded(name);
+  }
+
+  /// runs the top-level tests registered so far, sorted by name (lex) or by
+  /// their key for the --rng-seed (rand) or, for --fork-jobs, longest first;
+  /// declaration order breaks ties and with --failed-first the ones which
+  /// failed before go first
+  auto run_plan() -> void {
+    if (std::empty(plan())) {
+      return;
+    }
+    auto tests = std::exchange(plan(), {});
+    if (detail::cfg::sort_order == "rand") {
+      for (auto& test : tests) {
+        test.key = detail::shuffled(test.name, detail::cfg::rnd_seed);
+      }
+      std::stable_sort(tests.begin(), tests.end(),
+                       [](const planned& lhs, const planned& rhs) {
+                         return lhs.key < rhs.key;
+                       });
+    } else if (detail::cfg::sort_order == "lex") {
+      std::stable_sort(tests.begin(), tests.end(),
+                       [](const planned& lhs, const planned& rhs) {
+                         return lhs.name < rhs.name;
+                       });
+    } else if (detail::cfg::fork_jobs) {  // the longest children first
+      for (auto& test : tests) {
+        test.key = static_cast<std::uint64_t>(expected_ns(suite_name(), test.name));
+      }
+      std::stable_sort(tests.begin(), tests.end(),
+                       [](const planned& lhs, const planned& rhs) {
+                         return lhs.key > rhs.key;
+                       });
+    }
+    if (detail::cfg::failed_first and cache_) {
+      std::stable_partition(tests.begin(), tests.end(), [this](const planned& test) {
+        const auto* cached = cache_->find(suite_name(), test.name);
+        return cached and cached->failed;
+      });
+    }
+    for (auto& test : tests) {
+      test.run();
+    }
+  }
+
+  /// of the suite running on this thread
+  [[nodiscard]] auto suite_name() const -> std::string_view {
+    const auto suite = worker_ ? worker_->body.suite : body_.suite;
+    return suite and suite <= std::size(suites_) ? suites_[suite - 1].second
+                                                 : "global";
+  }
+
+  /// --cache-dir, the results are kept for each executable (--cache-key)
+  auto load_cache() -> void {
+    if (detail::cfg::cache_key != "") {
+      cache_.emplace(detail::cfg::cache_dir, detail::cfg::cache_key);
+      return;
+    }
+    const detail::mapped_file executable{"/proc/self/exe"};
+    cache_.emplace(detail::cfg::cache_dir,
+                   std::empty(executable.data()) ? detail::cfg::executable_name
+                                                 : executable.data());
+  }
+
+  [[nodiscard]] static auto repeating() -> bool {
+    return detail::cfg::repeat > 1 or detail::cfg::until_fail;
+  }
+
+  /// runs a top-level test --repeat times, or until it fails, in rounds of
+  /// --jobs concurrent repetitions, each of them recorded by a worker of its
+  /// own; only one of them is reported (the first failing one if any),
+  /// followed by the outcome of all of them
+  /// N.B. on a worker already, the repetitions run one after the other
   template <class... Ts>
-  auto on(events::skip<Ts...> test) {
-    reporter_.on(events::test_skip{.type = test.type, .name = test.name});
+  auto repeat(events::test<Ts...> test) -> void {
+    if constexpr (not std::copy_constructible<events::test<Ts...>>) {
+      const std::string name{test.name};
+      const auto previous_fails = fails();
+      run_test(std::move(test));
+      report(events::repetitions{.name = name,
+                                 .runs = 1,
+                                 .fails = fails() > previous_fails ? 1u : 0u,
+                                 .repeatable = false});
+    } else {
+      const auto limit = detail::cfg::until_fail and detail::cfg::repeat < 2
+                             ? std::numeric_limits<std::size_t>::max()
+                             : detail::cfg::repeat;
+      events::repetitions stats{.name = test.name};
+      std::optional<worker> shown{};
+      std::mutex mutex{};
+      const auto suite = body().suite;
+      const auto run_once = [&] {
+        worker context{.body = {.suite = suite}};
+        auto* const outer = std::exchange(worker_, &context);
+        run_test(test);
+        flush_passed();
+        worker_ = outer;
+
+        const std::scoped_lock lock{mutex};
+        ++stats.runs;
+        stats.fails += context.fails ? 1 : 0;
+        if (not shown or (context.fails and not shown->fails)) {
+          shown = std::move(context);
+        }
+      };
+
+      for (std::size_t runs{}; runs < limit;) {
+        const auto round =
+            worker_ ? 1 : math::min_value(limit - runs, concurrency());
+        if (round > 1) {
+          detail::thread_pool{round}.run(round, [&](std::size_t) { run_once(); });
+        } else {
+          run_once();
+        }
+        runs += round;
+        if (detail::cfg::until_fail and stats.fails) {
+          break;
+        }
+      }
+
+      if (worker_) {
+        shown->recording.replay(worker_->recording);
+      } else {
+        shown->recording.replay(reporter_);
+      }
+      fails() += shown->fails;
+      report(stats);
+    }
   }
 
-  template <class TExpr>
-  [[nodiscard]] auto on(events::assertion<TExpr> assertion) -> bool {
-    if (dry_run_) {
+  /// tests are listed rather than run
+  [[nodiscard]] auto listing() const -> bool {
+    return dry_run_ or detail::cfg::list_tags or detail::cfg::show_tests or
+           detail::cfg::show_test_names;
+  }
+
+  /// whether the top-level test registered last belongs to the shard being
+  /// run, by its position among all the tests registered by its suite (so
+  /// the other filters don't move tests between shards)
+  /// N.B. tests with a --durations-from history are balanced by time
+  [[nodiscard]] auto sharded(std::string_view name) -> bool {
+    const auto [index, count] = detail::cfg::shard();
+    const auto ordinal = body().suite + body().ordinal - 1;
+    if (count < 2) {
       return true;
     }
+    if (history_) {
+      if (const auto shard = history_->shard(suite_name(), name)) {
+        return *shard == index;
+      }
+    }
+    return ordinal % count == index;
+  }
 
-    if (static_cast<bool>(assertion.expr)) {
-      reporter_.on(events::assertion_pass<TExpr>{
-          .expr = assertion.expr, .location = assertion.location});
-      return true;
+  /// duration of the test in the cached run or else the --durations-from
+  /// history, 0 when unknown
+  [[nodiscard]] auto expected_ns(std::string_view suite,
+                                 std::string_view test) const -> std::int64_t {
+    if (cache_) {
+      if (const auto* cached = cache_->find(suite, test)) {
+        return cached->duration_ns;
+      }
     }
+    return history_ ? history_->duration_ns(suite, test) : 0;
+  }
 
-    ++fails_;
-    reporter_.on(events::assertion_fail<TExpr>{.expr = assertion.expr,
-                                               .location = assertion.location});
-    return false;
+  [[nodiscard]] auto expected_ns(std::string_view suite) const -> std::int64_t {
+    if (const auto cached = cache_ ? cache_->duration_ns(suite) : 0) {
+      return cached;
+    }
+    return history_ ? history_->duration_ns(suite) : 0;
   }
 
-  auto on(events::fatal_assertion fatal_assertion) {
-    reporter_.on(fatal_assertion);
-    std::exit(-1);
+  /// number of threads to run tests on (1: sequential)
+  [[nodiscard]] auto concurrency() const -> std::size_t {
+    if (listing()) {
+      return 1;
+    }
+    return detail::cfg::jobs ? detail::cfg::jobs
+                             : std::thread::hardware_concurrency();
   }
 
-  template <class TMsg>
-  auto on(events::log<TMsg> l) {
-    reporter_.on(l);
+  auto run_tasks() -> void {
+    if (std::empty(tasks_)) {
+      return;
+    }
+    auto tasks = std::exchange(tasks_, {});
+    schedule plan{.workers = std::vector<worker>(std::size(tasks)),
+                  .done = std::vector<bool>(std::size(tasks))};
+    schedule_ = &plan;
+    const auto execute = [&](const std::size_t i) {
+      worker_ = &plan.workers[i];
+      tasks[i].run();
+      flush_passed();
+      worker_ = nullptr;
+
+      const std::scoped_lock lock{plan.mutex};
+      plan.done[i] = true;
+      replay_completed();
+    };
+
+    std::vector<std::size_t> order(std::size(tasks));
+    for (std::size_t i{}; i < std::size(tasks); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const std::size_t lhs, const std::size_t rhs) {
+                       return tasks[lhs].expected_ns > tasks[rhs].expected_ns;
+                     });
+    detail::thread_pool{math::min_value(concurrency(), std::size(tasks))}.run(
+        order, [&](const std::size_t i) {
+          if (not tasks[i].serial) {
+            execute(i);
+          }
+        });
+    for (auto i = 0u; i < std::size(tasks); ++i) {
+      if (tasks[i].serial) {
+        execute(i);
+      }
+    }
+    schedule_ = nullptr;
+    drain();
   }
 
-  [[nodiscard]] auto run(run_cfg rc = {}) -> bool {
-    run_ = true;
-    reporter_.on(events::run_begin{.argc = rc.argc, .argv = rc.argv});
-    for (const auto& [suite, suite_name] : suites_) {
-      // add reporter in/out
-      if constexpr (requires { reporter_.on(events::suite_begin{}); }) {
-        reporter_.on(events::suite_begin{.type = "suite", .name = suite_name});
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+  /// top-level test run by a child process
+  struct child {
+    pid_t pid{};
+    int fd{};
+    std::string_view type{};
+    std::string name{};
+    reflection::source_location location{};
+    std::chrono::steady_clock::time_point start{};
+  };
+
+  /// runs the test in this process, --repeat times if asked to
+  template <class... Ts>
+  auto run_repeated(events::test<Ts...> test) -> void {
+    if (repeating()) {
+      repeat(std::move(test));
+    } else {
+      run_test(std::move(test));
+    }
+  }
+
+  template <class... Ts>
+  auto spawn(events::test<Ts...> test) -> void {
+    if (std::size(children_) >= detail::cfg::fork_jobs) {
+      reap();
+    }
+
+    int fds[2]{};
+    if (pipe(fds)) {
+      run_repeated(std::move(test));
+      return;
+    }
+
+    std::cout.flush();
+    std::fflush(nullptr);
+    const auto pid = fork();
+    if (pid < 0) {
+      close(fds[0]);
+      close(fds[1]);
+      run_repeated(std::move(test));
+      return;
+    }
+
+    if (not pid) {
+      close(fds[0]);
+      child_ = fds[1];
+      watchdog_.reset();
+      worker context{};
+      worker_ = &context;
+      run_repeated(std::move(test));
+      flush_child();
+      std::_Exit(0);
+    }
+
+    close(fds[1]);
+    children_.push_back(child{.pid = pid,
+                              .fd = fds[0],
+                              .type = test.type,
+                              .name = std::move(test.name),
+                              .location = test.location,
+                              .start = std::chrono::steady_clock::now()});
+  }
+
+  /// sends what has been recorded so far to the parent process
+  auto flush_child(worker& context = *worker_) -> void {
+    if (&context == worker_) {
+      flush_passed();
+    }
+    const auto data = context.recording.data();
+    for (std::size_t written{}; written < std::size(data);) {
+      const auto n =
+          write(child_, data.data() + written, std::size(data) - written);
+      if (n < 0 and errno == EINTR) {
+        continue;
       }
-      suite();
-      if constexpr (requires { reporter_.on(events::suite_end{}); }) {
-        reporter_.on(events::suite_end{.type = "suite", .name = suite_name});
+      if (n <= 0) {
+        break;
       }
+      written += static_cast<std::size_t>(n);
     }
-    suites_.clear();
+    context.recording.clear();
+  }
 
-    if (rc.report_errors) {
-      report_summary();
+  /// waits for the oldest child and replays its results
+  auto reap() -> void {
+    const auto oldest = std::move(children_.front());
+    children_.pop_front();
+
+    std::string data{};
+    std::array<char, 4096> buffer{};
+    for (;;) {
+      const auto n = read(oldest.fd, buffer.data(), std::size(buffer));
+      if (n < 0 and errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      data.append(buffer.data(), static_cast<std::size_t>(n));
     }
+    close(oldest.fd);
 
-    return fails_ > 0;
+    auto status = 0;
+    while (waitpid(oldest.pid, &status, 0) < 0 and errno == EINTR) {
+    }
+
+    // N.B. a fatal assertion only terminates the child, not the whole run
+    const auto stats = detail::recording::scan(data);
+    detail::recording::replay(
+        std::string_view{data}.substr(0, stats.fatal.value_or(std::size(data))),
+        reporter_);
+    fails_ += stats.fails;
+    if (cache_) {
+      cache_->record(suite_name(), oldest.name,
+                     stats.fails > 0 or status != 0,
+                     std::chrono::steady_clock::now() - oldest.start);
+    }
+
+    // the child crashed or exited in the middle of the test
+    const auto open = std::empty(data) ? 1u : stats.depth;
+    if (not open) {
+      return;
+    }
+    if (std::empty(data)) {
+      report(events::test_begin{
+          .type = oldest.type, .name = oldest.name, .location = oldest.location});
+    }
+    if (not stats.fatal) {
+      ++fails_;
+      const auto what =
+          WIFSIGNALED(status)
+              ? "terminated by signal " + std::to_string(WTERMSIG(status))
+              : "exited with status " + std::to_string(WEXITSTATUS(status));
+      report(events::exception{what.c_str()});
+    }
+    for (auto i = 1u; i < open; ++i) {
+      report(events::test_finish{.type = oldest.type, .name = oldest.name});
+    }
+    report(events::test_end{.type = oldest.type, .name = oldest.name});
   }
+#endif
 
-  auto report_summary() -> void {
-    if (static auto once = true; once) {
-      once = false;
-      reporter_.on(events::summary{});
+  auto reap_children() -> void {
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    while (not std::empty(children_)) {
+      reap();
     }
+#endif
   }
 
- protected:
+  /// replays the longest prefix of finished tasks (requires schedule lock)
+  auto replay_completed() -> void {
+    auto& workers = schedule_->workers;
+    auto& replayed = schedule_->replayed;
+    for (; replayed < std::size(workers) and schedule_->done[replayed];
+         ++replayed) {
+      workers[replayed].recording.replay(reporter_);
+      fails_ += workers[replayed].fails;
+      workers[replayed].recording = {};
+    }
+  }
+
+  static inline thread_local worker* worker_{};
+  schedule* schedule_{};
+  std::vector<task> tasks_{};
+  std::vector<planned> plan_{};
+  suite_body body_{};
+  std::size_t passed_{};
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+  std::deque<child> children_{};
+#endif
+  int child_{-1};  /// pipe to the parent process (forked child only)
+  static inline thread_local bool owner_{};  /// thread creating the runner
+  detail::channel channel_{};
+
   TReporter reporter_{};
   std::vector<std::pair<void (*)(), std::string_view>> suites_{};
   std::size_t level_{};
@@ -2205,19 +5816,26 @@ class runner {
   std::size_t fails_{};
   std::array<std::string_view, MaxPathSize> path_{};
   filter filter_{};
-  std::vector<std::string_view> tag_{};
+  detail::tag_index tags_{};
+  std::optional<detail::name_set> selection_{};  /// --input-file
+  std::optional<detail::result_cache> cache_{};   /// --cache-dir
+  std::optional<detail::duration_history> history_{};  /// --durations-from
   bool dry_run_{};
+  detail::watchdog watchdog_{};
 };
 
 struct override {};
 
 template <class = override, class...>
 //[[maybe_unused]] inline auto cfg = runner<reporter<printer>>{};// alt reporter
-[[maybe_unused]] inline auto cfg = runner<reporter_junit<printer>>{};
+[[maybe_unused]] inline auto cfg =
+    runner<reporter_select<reporter_junit<printer>, reporter_jsonl<printer>,
+                           reporter_tap<printer>, reporter_binlog<printer>>>{};
 
 namespace detail {
 struct tag {
   std::vector<std::string_view> name{};
+  std::chrono::milliseconds timeout{};  /// see `timeout`
 };
 
 template <class... Ts, class TEvent>
@@ -2243,6 +5861,7 @@ struct test {
   std::optional<std::string> backingName;
   std::string_view name{};
   std::vector<std::string_view> tag{};
+  std::chrono::milliseconds timeout{};
 
   test(std::string_view t, std::string_view sv) : type(t), name(sv) {}
   test(std::string_view t, const std::string& s) : type(t), name(s) {}
@@ -2256,6 +5875,7 @@ struct test {
     on<Ts...>(events::test<void (*)()>{.type = type,
                                        .name = std::string{name},
                                        .tag = tag,
+                                       .timeout = timeout,
                                        .location = _test.location,
                                        .arg = none{},
                                        .run = _test.test});
@@ -2268,6 +5888,7 @@ struct test {
     on<Test>(events::test<Test>{.type = type,
                                 .name = std::string{name},
                                 .tag = tag,
+                                .timeout = timeout,
                                 .location = {},
                                 .arg = none{},
                                 .run = static_cast<Test&&>(_test)});
@@ -2355,39 +5976,41 @@ struct that_ {
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator==(const TRhs& rhs) const {
-      return eq_{t_, rhs};
+      return eq_{*t_, rhs};
     }
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator!=(const TRhs& rhs) const {
-      return neq_{t_, rhs};
+      return neq_{*t_, rhs};
     }
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator>(const TRhs& rhs) const {
-      return gt_{t_, rhs};
+      return gt_{*t_, rhs};
     }
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator>=(const TRhs& rhs) const {
-      return ge_{t_, rhs};
+      return ge_{*t_, rhs};
     }
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator<(const TRhs& rhs) const {
-      return lt_{t_, rhs};
+      return lt_{*t_, rhs};
     }
 
     template <class TRhs>
     [[nodiscard]] constexpr auto operator<=(const TRhs& rhs) const {
-      return le_{t_, rhs};
+      return le_{*t_, rhs};
     }
 
     [[nodiscard]] constexpr operator bool() const {
-      return static_cast<bool>(t_);
+      return static_cast<bool>(*t_);
     }
 
-    const T t_{};
+    constexpr auto capture() -> void { t_.capture(); }
+
+    operand<T> t_;
   };
 
   template <class T>
@@ -2715,6 +6338,11 @@ template <class Test>
   for (const auto& name : tag.name) {
     test.tag.push_back(name);
   }
+  if constexpr (requires { test.timeout; }) {
+    if (tag.timeout.count()) {
+      test.timeout = tag.timeout;
+    }
+  }
   return test;
 }
 
@@ -2728,7 +6356,7 @@ template <class Test>
   for (const auto& name : rhs.name) {
     tag.push_back(name);
   }
-  return detail::tag{tag};
+  return detail::tag{tag, rhs.timeout.count() ? rhs.timeout : lhs.timeout};
 }
 
 template <class F, class T>
@@ -3094,6 +6722,10 @@ struct suite {
   return detail::tag{{name}};
 };
 [[maybe_unused]] inline auto skip = tag("skip");
+/// ends the run when the test takes longer, e.g. `timeout(500ms) / "name"_test`
+[[maybe_unused]] inline auto timeout = [](const std::chrono::milliseconds duration) {
+  return detail::tag{.name = {}, .timeout = duration};
+};
 template <class T = void>
 [[maybe_unused]] constexpr auto type = detail::type_<T>();
 
@@ -10,14 +10,24 @@
 #include <algorithm>
 #include <any>
 #include <array>
+#include <atomic>
 #include <complex>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -191,6 +201,7 @@ class fake_calculator {
 
 struct test_reporter : ut::reporter<ut::printer> {
   using reporter::asserts_;
+  using reporter::repeated_;
   using reporter::tests_;
   using reporter::operator=;
 };
@@ -205,6 +216,11 @@ struct test_empty {
   auto operator()() -> void {}
 };
 
+struct test_move_only {
+  std::unique_ptr<int*> calls{};
+  auto operator()() -> void { ++**calls; }
+};
+
 struct test_throw {
   // NOLINTNEXTLINE(hicpp-exception-baseclass)
   auto operator()() -> void { throw 42; }
@@ -311,6 +327,53 @@ struct test_summary_runner : ut::runner<test_summary_reporter> {
   using runner::reporter_;
 };
 
+struct test_ordered_reporter : test_reporter {
+  using test_reporter::on;
+
+  auto on(ut::events::run_begin) -> void { begun = true; }
+
+  auto on(ut::events::test_begin test_begin) -> void {
+    names.emplace_back(test_begin.name);
+    early += not begun;
+    test_reporter::on(test_begin);
+  }
+
+  std::vector<std::string> names{};
+  bool begun{};
+  std::size_t early{};  /// tests reported before run_begin
+};
+
+struct test_parallel_runner : ut::runner<test_ordered_reporter> {
+  using runner::cache_;
+  using runner::reporter_;
+  using runner::tags_;
+};
+
+test_parallel_runner* parallel_run{};
+
+std::function<void()> suite_body{};  /// of `test_suite`
+auto test_suite() -> void { suite_body(); }
+
+template <int Passes, int Fails>
+auto test_parallel_suite() -> void {
+  static const auto name = std::to_string(Passes);
+  parallel_run->on(ut::events::test<void (*)()>{
+      .type = "test",
+      .name = name,
+      .location = {},
+      .arg = ut::none{},
+      .run = [] {
+        for (auto i = 0; i < Passes; ++i) {
+          void(parallel_run->on(
+              ut::events::assertion<bool>{.expr = true, .location = {}}));
+        }
+        for (auto i = 0; i < Fails; ++i) {
+          void(parallel_run->on(
+              ut::events::assertion<bool>{.expr = false, .location = {}}));
+        }
+      }});
+}
+
 namespace ns {
 namespace {
 template <char... Cs>
@@ -363,6 +426,28 @@ struct custom_non_printable_type {
   int value;
 };
 
+struct copy_counted {
+  static inline auto copies = 0;
+
+  explicit copy_counted(int v) : value{v} {}
+  copy_counted(const copy_counted& other) : value{other.value} { ++copies; }
+  auto operator=(const copy_counted&) -> copy_counted& = delete;
+  ~copy_counted() = default;
+
+  friend auto operator==(const copy_counted& lhs, const copy_counted& rhs) {
+    return lhs.value == rhs.value;
+  }
+  friend auto operator<(const copy_counted& lhs, const copy_counted& rhs) {
+    return lhs.value < rhs.value;
+  }
+  friend auto operator<<(std::ostream& os, const copy_counted& c)
+      -> std::ostream& {
+    return os << c.value;
+  }
+
+  int value{};
+};
+
 struct custom_printable_type {
   int value;
 };
@@ -442,6 +527,29 @@ int main() {  // NOLINT(readability-function-size)
 #endif
     }
 
+    {
+      constexpr reflection::source_location recorded{"file.cpp", 42};
+      static_assert("file.cpp"sv == recorded.file_name());
+      static_assert(42 == recorded.line());
+      static_assert(""sv == recorded.function_name());
+      static_assert(0 == recorded.column());
+
+#if defined(__cpp_lib_source_location) && !defined(_LIBCPP_APPLE_CLANG_VER)
+      static_assert(std::is_convertible_v<reflection::std_source_location,
+                                          reflection::source_location>);
+      const reflection::std_source_location std_location =
+          std::source_location::current();
+      const reflection::source_location location = std_location;
+      test_assert(std::string_view{location.file_name()} ==
+                  std_location.file_name());
+      test_assert(std::string_view{location.function_name()} ==
+                  std_location.function_name());
+      test_assert(location.line() == static_cast<int>(std_location.line()));
+      test_assert(location.column() ==
+                  static_cast<int>(std_location.column()));
+#endif
+    }
+
     {
       static_assert(utility::regex_match("", ""));
       static_assert(utility::regex_match("hello", "hello"));
@@ -454,6 +562,69 @@ int main() {  // NOLINT(readability-function-size)
       static_assert(not utility::regex_match("", "hello"));
       static_assert(not utility::regex_match("hi", "hello"));
       static_assert(not utility::regex_match("hello there", "hello"));
+
+      static_assert(utility::regex_match("hello", "h.*o"));
+      static_assert(utility::regex_match("ho", "h.*o"));
+      static_assert(not utility::regex_match("hello!", "h.*o"));
+      static_assert(utility::regex_match("a.b", "a\\.b"));
+      static_assert(not utility::regex_match("axb", "a\\.b"));
+      static_assert(utility::regex_match("abab", "(ab)+"));
+      static_assert(not utility::regex_match("", "(ab)+"));
+      static_assert(utility::regex_match("color", "colou?r"));
+      static_assert(utility::regex_match("colour", "colou?r"));
+      static_assert(utility::regex_match("test", "suite|test"));
+      static_assert(not utility::regex_match("tests", "suite|test"));
+      static_assert(utility::regex_match("f(1)", "f\\(1\\)"));
+      static_assert(utility::regex_match("", "(a*)*"));
+      static_assert(utility::regex_match("aaa", "(a|aa)*"));
+      static_assert(utility::regex_match("*a", "*a"));
+      static_assert(not utility::regex_match("a", "*a"));
+      static_assert(utility::regex_match("++", "+*"));
+      static_assert(utility::regex_match("*", "(*)"));
+      static_assert(utility::regex_match("?", "a|?"));
+
+      const auto input = std::string(10'000, 'a');
+      test_assert(not utility::regex(".*a.*a.*a.*a.*a.*a.*a.*a.*b").match(input));
+      test_assert(utility::regex("(a|aa)*").match(input));
+      for (const auto* name : {"suite", "test", "tests"}) {
+        test_assert(utility::regex_match(name, "suite|test") ==
+                    (std::string_view{name} != "tests"));
+      }
+      test_assert(utility::regex_match("*a", "*a"));
+    }
+
+    {
+      auto calls = 0;
+      utility::function<int(int)> small{[&calls](int i) { return calls += i; }};
+      test_assert(1 == small(1));
+
+      const auto text = std::make_shared<std::string>("text");
+      utility::function<std::size_t()> shared{[text] { return text->size(); }};
+      test_assert(2 == text.use_count());
+
+      const std::array<std::string, 4> words{"a", "bb", "ccc", "dddd"};
+      utility::function<std::size_t(std::size_t)> large{
+          [words](std::size_t i) { return words[i].size(); }};
+
+      auto moved = std::move(small);
+      test_assert(3 == moved(2));
+      small = std::move(moved);
+      test_assert(6 == small(3));
+
+      std::vector<utility::function<std::size_t()>> functions{};
+      functions.emplace_back(std::move(shared));
+      for (auto i = 0; i < 100; ++i) {
+        functions.emplace_back([i] { return std::size_t(i); });
+      }
+      test_assert(4 == functions[0]());
+      test_assert(99 == functions.back()());
+      test_assert(2 == text.use_count());
+
+      test_assert(3 == large(2));
+      large = [](std::size_t i) { return i; };
+      test_assert(4 == large(4));
+      functions.clear();
+      test_assert(1 == text.use_count());
     }
 
     {
@@ -468,6 +639,17 @@ int main() {  // NOLINT(readability-function-size)
       test_assert(not utility::is_match("abc", "b??"));
       test_assert(not utility::is_match("abc", "a*d"));
       test_assert(not utility::is_match("abc", "*C"));
+
+      static_assert(utility::is_match("suite.test", "*.*"));
+      static_assert(utility::is_match("aaa", "*a*a*a*"));
+      static_assert(utility::is_match("abcbcd", "a*bcd"));
+      static_assert(utility::is_match("mississippi", "m*iss*pi"));
+      static_assert(not utility::is_match("mississippi", "m*iss*pix"));
+      static_assert(not utility::is_match("aa", "*a*a*a*"));
+
+      const auto input = std::string(10'000, 'a');
+      test_assert(not utility::is_match(input, "*a*a*a*a*a*a*a*a*b"));
+      test_assert(utility::is_match(input, "*a*a*a*a*a*a*a*a*"));
     }
 
     {
@@ -610,6 +792,34 @@ int main() {  // NOLINT(readability-function-size)
       test_assert(not(42_i < 0));
     }
 
+#if defined(BOOST_UT_HAS_FORMAT)
+    {
+      const auto same = [](const auto&... values) {
+        ut::printer stream{{.none = "", .pass = "", .fail = ""}};
+        ut::format_printer format{{.none = "", .pass = "", .fail = ""}};
+        ((stream << values << '|'), ...);
+        ((format << values << '|'), ...);
+        return stream.str() == format.str();
+      };
+      test_assert(same(0, -42, 42u, std::int64_t{-1} << 40, 'c', "str",
+                       std::string{"s"}, std::string_view{"sv"}));
+      test_assert(same(0.1, 1. / 3, 1e6, 1e-7, 123456789.0, -0.0, 42.42f,
+                       std::numeric_limits<double>::infinity()));
+      test_assert(same(true, false, std::boolalpha, true, false));
+      test_assert(same(std::setprecision(10), 1. / 3, std::hex, 255));
+      test_assert(same(custom{42}, std::vector{1, 2}, custom_vec{1, 2}));
+      test_assert(same(42_i == 43, 1.5_d != 1.5, "true"_b and 1_i > 2,
+                       type<int> == type<float>));
+
+      ut::format_printer printer{};
+      printer << 42;
+      test_assert("42" == printer.view());
+      printer.clear();
+      printer << 1.5;
+      test_assert("1.5" == printer.str());
+    }
+#endif
+
     {
       test_assert("0 == 0" == to_string(0_s == _s(0)));
       test_assert("0 != 0" == to_string(0_s != _s(0)));
@@ -648,6 +858,36 @@ int main() {  // NOLINT(readability-function-size)
       static_assert(type<int> != type<void>);
     }
 
+    {
+      const copy_counted lhs{42};
+      const copy_counted rhs{42};
+      const copy_counted other{43};
+      copy_counted::copies = 0;
+
+      test_assert(eq(lhs, rhs));
+      test_assert(that % lhs == rhs);
+      test_assert(that % lhs < other);
+      test_assert(0 == copy_counted::copies);
+
+      const auto failed = that % lhs == other;
+      test_assert(2 == copy_counted::copies);
+      test_assert(not static_cast<bool>(failed));
+
+      const auto both = (that % lhs == rhs) and (that % lhs == other);
+      test_assert(8 == copy_counted::copies);
+      test_assert(not static_cast<bool>(both));
+
+      test_assert("42 == 43" == to_string(failed));
+      test_assert("(42 == 42 and 42 == 43)" == to_string(both));
+
+      copy_counted::copies = 0;
+      static_assert(std::is_reference_v<decltype(failed.lhs())>);
+      static_assert(std::is_reference_v<decltype(both.rhs().rhs())>);
+      test_assert(42 == failed.lhs().value and 43 == failed.rhs().value);
+      test_assert(43 == both.rhs().rhs().value);
+      test_assert(0 == copy_counted::copies);
+    }
+
     {
       std::stringstream out{};
       std::stringstream err{};
@@ -681,6 +921,60 @@ int main() {  // NOLINT(readability-function-size)
       std::cerr.rdbuf(old_cerr);
     }
 
+    {
+      std::stringstream out{};
+      std::stringstream err{};
+      auto* old_cout = std::cout.rdbuf(out.rdbuf());
+      auto* old_cerr = std::cerr.rdbuf(err.rdbuf());
+
+      auto reporter = test_reporter{};
+      reporter = printer{colors{.none = "", .pass = "", .fail = "", .skip = ""}};
+      reporter.on(events::test_begin{.type = "test", .name = "pass"});
+      reporter.on(events::log<std::string_view>{.msg = "logged"});
+      reporter.on(events::test_end{.type = "test", .name = "pass"});
+      reporter.on(events::test_begin{.type = "test", .name = "fail"});
+      reporter.on(events::assertion_fail<bool>{.expr = false, .location = {}});
+      reporter.on(events::test_end{.type = "test", .name = "fail"});
+      ut::detail::recording recording{};
+      recording.on(events::repetitions{.name = "fail", .runs = 4, .fails = 1});
+      recording.on(events::repetitions{
+          .name = "once", .runs = 1, .fails = 0, .repeatable = false});
+      recording.replay(reporter);
+      test_assert(std::empty(err.str()));  // until the summary
+      reporter.on(events::summary{});
+      test_assert(err.str().starts_with(
+          "Running \"pass\"...loggedPASSED\nRunning \"fail\"...\n  "));
+      test_assert(err.str().find(":FAILED [false]\nFAILED\n\n=====") !=
+                  std::string::npos);
+      test_assert(err.str().find(
+                      "\nRepetitions:\n  \"fail\": 3 passed, 1 failed "
+                      "(flakiness 0.25)\n  \"once\": not repeatable (not "
+                      "copyable), run once\n") != std::string::npos);
+      test_assert(std::empty(out.str()));
+
+      std::cout.rdbuf(old_cout);
+      std::cerr.rdbuf(old_cerr);
+    }
+
+    {
+      std::stringstream out{};
+      ut::detail::spill_buffer buffer{8};
+      buffer.append("0123");
+      buffer.write_to(out);
+      test_assert("0123" == out.str());
+      test_assert(buffer.empty());
+
+      out.str("");
+      buffer.append("abcdef");
+      buffer.append("ghij");  // spilled
+      buffer.append("0123456789");
+      buffer.append("kl");
+      test_assert(not buffer.empty());
+      buffer.write_to(out);
+      test_assert("abcdefghij0123456789kl" == out.str());
+      test_assert(buffer.empty());
+    }
+
     {
       test_runner run;
       auto& reporter = run.reporter_;
@@ -860,6 +1154,1138 @@ int main() {  // NOLINT(readability-function-size)
       test_assert(1 == run_count);
     }
 
+    {
+      std::stringstream err{};
+      auto* old_cerr = std::cerr.rdbuf(err.rdbuf());
+      ut::detail::cfg::jobs = 3;
+      {
+        test_parallel_runner run;
+        parallel_run = &run;
+        run.on(events::suite<void (*)()>{.run = test_parallel_suite<1, 0>,
+                                         .name = "1"});
+        run.on(events::suite<void (*)()>{.run = test_parallel_suite<2, 1>,
+                                         .name = "2"});
+        run.on(events::suite<void (*)()>{.run = test_parallel_suite<3, 0>,
+                                         .name = "3"});
+        run.on(events::suite<void (*)()>{.run = test_parallel_suite<4, 2>,
+                                         .name = "4"});
+        test_assert(run.run());
+
+        auto& reporter = run.reporter_;
+        test_assert((std::vector<std::string>{"1", "2", "3", "4"} ==
+                     reporter.names));
+        test_assert(10 == reporter.asserts_.pass);
+        test_assert(3 == reporter.asserts_.fail);
+        test_assert(2 == reporter.tests_.pass);
+        test_assert(2 == reporter.tests_.fail);
+        parallel_run = nullptr;
+      }
+      ut::detail::cfg::jobs = 1;
+      std::cerr.rdbuf(old_cerr);
+      test_assert(not std::empty(err.str()));
+    }
+
+    {
+      ut::detail::cfg::jobs = 3;
+      ut::detail::cfg::parallel_tests = true;
+      {
+        test_parallel_runner run;
+        parallel_run = &run;
+        const auto main_thread = std::this_thread::get_id();
+        std::thread::id serial_thread{};
+
+        const auto test = [&](std::string name, std::function<void()> body,
+                              std::vector<std::string_view> tag = {}) {
+          run.on(events::test<std::function<void()>>{.type = "test",
+                                                      .name = std::move(name),
+                                                      .tag = std::move(tag),
+                                                      .location = {},
+                                                      .arg = none{},
+                                                      .run = std::move(body)});
+        };
+        const auto expect = [&](const bool result) {
+          void(run.on(events::assertion<bool>{.expr = result, .location = {}}));
+        };
+
+        suite_body = [&] {
+          auto returned = false;  // the tests run before the body returns
+          test("1", [&] { expect(not returned); });
+          test("2", [&] { test("2.1", [&] { expect(not returned); }); });
+          test(
+              "3", [&] { serial_thread = std::this_thread::get_id(); },
+              {"serial"});
+          test_assert(std::empty(run.reporter_.names));
+          test("4", [&] { expect(returned); });
+          returned = true;
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "s"});
+
+        test_assert(run.run());
+        test_assert(main_thread == serial_thread);
+
+        auto& reporter = run.reporter_;
+        test_assert((std::vector<std::string>{"1", "2", "3", "4"} ==
+                     reporter.names));
+        test_assert(2 == reporter.asserts_.pass);
+        test_assert(1 == reporter.asserts_.fail);
+        test_assert(3 == reporter.tests_.pass);
+        test_assert(1 == reporter.tests_.fail);
+        parallel_run = nullptr;
+      }
+      ut::detail::cfg::parallel_tests = false;
+      ut::detail::cfg::jobs = 1;
+    }
+
+    {
+      ut::detail::cfg::shard_index = 1;
+      ut::detail::cfg::shard_count = 2;
+      {
+        test_parallel_runner run;
+        for (const auto* name : {"0", "1", "2", "3", "4"}) {
+          run.on(events::test<test_empty>{.type = "test",
+                                          .name = name,
+                                          .location = {},
+                                          .arg = none{},
+                                          .run = test_empty{}});
+        }
+        test_assert(
+            (std::vector<std::string>{"1", "3"} == run.reporter_.names));
+      }
+
+      ut::detail::cfg::input_filename = "ut_shard_input_file.txt";
+      {
+        std::ofstream file{ut::detail::cfg::input_filename};
+        file << "0\n2\n3\n";
+      }
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());  // loads the file
+        for (const auto* name : {"0", "1", "2", "3", "4"}) {
+          run.on(events::test<test_empty>{.type = "test",
+                                          .name = name,
+                                          .location = {},
+                                          .arg = none{},
+                                          .run = test_empty{}});
+        }
+        // same shards, whichever tests are selected
+        test_assert((std::vector<std::string>{"3"} == run.reporter_.names));
+      }
+      std::remove(ut::detail::cfg::input_filename.c_str());
+      ut::detail::cfg::input_filename = "";
+      ut::detail::cfg::shard_index = 0;
+      ut::detail::cfg::shard_count = 0;
+    }
+
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+    {
+      ut::detail::cfg::fork_jobs = 2;
+      {
+        test_parallel_runner run;
+        const auto test = [&](std::string name, std::function<void()> body) {
+          run.on(events::test<std::function<void()>>{.type = "test",
+                                                      .name = std::move(name),
+                                                      .location = {},
+                                                      .arg = none{},
+                                                      .run = std::move(body)});
+        };
+        const auto expect = [&](const bool result) {
+          void(run.on(events::assertion<bool>{.expr = result, .location = {}}));
+        };
+
+        test("pass", [&] { expect(true); });
+        test("fail", [&] { expect(false); });
+        test("fatal", [&] {
+          expect(false);
+          run.on(events::fatal_assertion{});
+        });
+        test("crash", [] { std::_Exit(1); });
+        test("last", [&] { expect(true); });
+        test_assert(run.run());
+
+        auto& reporter = run.reporter_;
+        test_assert(3 == reporter.early);  // the others were reaped by `run`
+        test_assert((std::vector<std::string>{"pass", "fail", "fatal", "crash",
+                                              "last"} == reporter.names));
+        test_assert(2 == reporter.asserts_.pass);
+        test_assert(3 == reporter.asserts_.fail);
+        test_assert(2 == reporter.tests_.pass);
+        test_assert(3 == reporter.tests_.fail);
+      }
+
+      ut::detail::cfg::timeout_ms = 10'000;
+      {
+        test_parallel_runner run;
+        const auto test = [&](std::string name, std::chrono::milliseconds timeout,
+                              std::function<void()> body) {
+          run.on(events::test<std::function<void()>>{.type = "test",
+                                                      .name = std::move(name),
+                                                      .timeout = timeout,
+                                                      .location = {},
+                                                      .arg = none{},
+                                                      .run = std::move(body)});
+        };
+
+        test("hang", std::chrono::milliseconds{50}, [&] {
+          run.on(events::test<std::function<void()>>{
+              .type = "test",
+              .name = "nested",
+              .location = {},
+              .arg = none{},
+              .run = [] { std::this_thread::sleep_for(std::chrono::hours{1}); }});
+        });
+        test("quick", {}, [&] {
+          void(run.on(events::assertion<bool>{.expr = true, .location = {}}));
+        });
+        test_assert(run.run());
+
+        auto& reporter = run.reporter_;
+        test_assert((std::vector<std::string>{"hang", "quick"} == reporter.names));
+        test_assert(1 == reporter.asserts_.pass);
+        test_assert(1 == reporter.asserts_.fail);
+        test_assert(1 == reporter.tests_.pass);
+        test_assert(1 == reporter.tests_.fail);
+      }
+      ut::detail::cfg::timeout_ms = 0;
+      ut::detail::cfg::fork_jobs = 0;
+    }
+
+    {
+      {
+        ut::detail::watchdog watchdog{};
+        auto id = 0;
+        watchdog.arm(&id, std::chrono::milliseconds{10}, "disarmed\n");
+        watchdog.disarm(&id);
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+      }  // joins the thread
+
+      std::array<int, 2> fds{};
+      test_assert(0 == pipe(fds.data()));
+      const auto pid = fork();
+      if (not pid) {
+        close(fds[0]);
+        dup2(fds[1], STDERR_FILENO);
+        ut::detail::watchdog watchdog{};
+        auto id = 0;
+        watchdog.arm(&id, std::chrono::milliseconds{10}, "timed out\n");
+        std::this_thread::sleep_for(std::chrono::hours{1});
+        std::_Exit(0);
+      }
+      close(fds[1]);
+      std::string err{};
+      std::array<char, 64> buffer{};
+      for (auto n = read(fds[0], buffer.data(), std::size(buffer)); n > 0;
+           n = read(fds[0], buffer.data(), std::size(buffer))) {
+        err.append(buffer.data(), static_cast<std::size_t>(n));
+      }
+      close(fds[0]);
+      auto status = 0;
+      waitpid(pid, &status, 0);
+      test_assert("timed out\n" == err);
+      test_assert(WIFEXITED(status) and 0 != WEXITSTATUS(status));
+    }
+#endif
+
+    {
+      using namespace std::chrono_literals;
+      const auto tagged = ut::tag("slow") / ut::timeout(500ms) / ut::test("t");
+      test_assert((std::vector<std::string_view>{"slow"} == tagged.tag));
+      test_assert(500ms == tagged.timeout);
+      test_assert(1s == (ut::timeout(1s) / ut::tag("db")).timeout);
+      test_assert(0ms == ut::test("untimed").timeout);
+    }
+
+    {
+      test_runner run;
+      auto& reporter = run.reporter_;
+      run.run_ = true;
+
+      run.on(events::test<std::function<void()>>{
+          .type = "test",
+          .name = "threads",
+          .location = {},
+          .arg = none{},
+          .run = [&] {
+            std::vector<std::thread> threads{};
+            for (auto i = 0; i < 32; ++i) {
+              threads.emplace_back([&] {
+                for (auto j = 0; j < 1'000; ++j) {
+                  void(run.on(
+                      events::assertion<bool>{.expr = true, .location = {}}));
+                }
+                void(run.on(
+                    events::assertion<bool>{.expr = false, .location = {}}));
+              });
+            }
+            for (auto& thread : threads) {
+              thread.join();
+            }
+          }});
+
+      test_assert(32'000 == reporter.asserts_.pass);
+      test_assert(32 == reporter.asserts_.fail);
+      test_assert(0 == reporter.tests_.pass);
+      test_assert(1 == reporter.tests_.fail);
+      reporter = printer{};
+    }
+
+    {
+      ut::detail::channel first{};
+      ut::detail::channel second{};
+      std::size_t passed[2]{};
+
+      std::thread{[&] {
+        for (auto i = 0; i < 1'000; ++i) {
+          first.pass();
+          second.pass();
+        }
+      }}.join();
+      first.pass();
+
+      first.drain([&](auto n) { passed[0] += n; }, [](const auto&) {});
+      second.drain([&](auto n) { passed[1] += n; }, [](const auto&) {});
+      test_assert(1'001 == passed[0]);
+      test_assert(1'000 == passed[1]);
+      test_assert(2 == first.slots());
+      test_assert(1 == second.slots());
+    }
+
+    {
+      test_runner run;
+      auto& reporter = run.reporter_;
+      run.run_ = true;
+
+      run.on(events::test<std::function<void()>>{
+          .type = "test",
+          .name = "counting",
+          .location = {},
+          .arg = none{},
+          .run = [&] {
+            for (auto i = 0; i < 1'000; ++i) {
+              void(run.on(
+                  events::assertion<bool>{.expr = true, .location = {}}));
+            }
+            void(run.on(events::assertion<bool>{.expr = false, .location = {}}));
+            void(run.on(events::assertion<bool>{.expr = true, .location = {}}));
+          }});
+
+      test_assert(1'001 == reporter.asserts_.pass);
+      test_assert(1 == reporter.asserts_.fail);
+      test_assert(1 == reporter.tests_.fail);
+      reporter = printer{};
+    }
+
+    {
+      const auto run_in_order = [](const std::vector<std::string>& names) {
+        test_parallel_runner run;
+        suite_body = [&] {
+          for (const auto& name : names) {
+            test_assert(std::empty(run.reporter_.names));  // registered only
+            run.on(events::test<void (*)()>{.type = "test",
+                                            .name = name,
+                                            .location = {},
+                                            .arg = none{},
+                                            .run = [] {}});
+          }
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "s"});
+        test_assert(not run.run());
+        return run.reporter_.names;
+      };
+
+      ut::detail::cfg::sort_order = "lex";
+      test_assert((std::vector<std::string>{"a", "b", "c", "c"} ==
+                   run_in_order({"c", "a", "c", "b"})));
+
+      ut::detail::cfg::sort_order = "rand";
+      ut::detail::cfg::rnd_seed = 42;
+      const auto names = std::vector<std::string>{"1", "2", "3", "4", "5", "6"};
+      auto shuffled = run_in_order(names);
+      test_assert(shuffled == run_in_order(names));
+      test_assert(shuffled != names);
+      test_assert(std::is_permutation(shuffled.begin(), shuffled.end(),
+                                      names.begin()));
+      std::erase(shuffled, "3");  // same relative order for a subset
+      test_assert(shuffled == run_in_order({"1", "2", "4", "5", "6"}));
+      test_assert(ut::detail::shuffled("1", 42) != ut::detail::shuffled("1", 43));
+
+      {
+        test_parallel_runner run;
+        suite_body = [&] {
+          auto returned = false;  // the plan runs before the body returns
+          for (const auto* name : {"1", "2", "3"}) {
+            run.on(events::test<std::function<void()>>{
+                .type = "test",
+                .name = name,
+                .location = {},
+                .arg = none{},
+                .run = [&run, &returned] {
+                  void(run.on(
+                      events::assertion<bool>{.expr = not returned, .location = {}}));
+                }});
+          }
+          returned = true;
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "s"});
+        test_assert(not run.run());
+        test_assert(3 == run.reporter_.asserts_.pass);
+        test_assert(0 == run.reporter_.asserts_.fail);
+      }
+      ut::detail::cfg::rnd_seed = 0;
+      ut::detail::cfg::sort_order = "decl";
+    }
+
+    {
+      ut::detail::cfg::repeat = 10;
+      ut::detail::cfg::jobs = 4;
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());
+        std::atomic<int> calls{};
+        run.on(events::test<std::function<void()>>{
+            .type = "test",
+            .name = "flaky",
+            .location = {},
+            .arg = none{},
+            .run = [&] {
+              void(run.on(events::assertion<bool>{.expr = calls++ % 3 != 0,
+                                                  .location = {}}));
+            }});
+        test_assert(10 == calls);
+        test_assert((std::vector<std::string>{"flaky"} == run.reporter_.names));
+        test_assert(1 == run.reporter_.tests_.fail);
+        test_assert(1 == run.reporter_.asserts_.fail);
+        const auto& repeated = run.reporter_.repeated_.tests;
+        test_assert(1u == std::size(repeated));
+        test_assert("flaky" == repeated[0].name);
+        test_assert(10u == repeated[0].runs);
+        test_assert(4u == repeated[0].fails);
+        test_assert(repeated[0].repeatable);
+      }
+
+      {
+        test_parallel_runner run;
+        std::mutex mutex{};
+        std::vector<std::set<std::thread::id>> threads(2);
+        const auto repeated = [&](const std::size_t i) {
+          return [&, i] {
+            const std::scoped_lock lock{mutex};
+            threads[i].insert(std::this_thread::get_id());
+          };
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "a"});
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "b"});
+        std::atomic<std::size_t> suites{};
+        suite_body = [&] {
+          const auto i = suites++ % 2;
+          run.on(events::test<std::function<void()>>{.type = "test",
+                                                      .name = "repeated",
+                                                      .location = {},
+                                                      .arg = none{},
+                                                      .run = repeated(i)});
+        };
+        test_assert(not run.run());
+        // the suites run on the pool, each repeats its test on its own thread
+        test_assert(1u == std::size(threads[0]) and 1u == std::size(threads[1]));
+        test_assert(2u == std::size(run.reporter_.repeated_.tests));
+        test_assert(10u == run.reporter_.repeated_.tests[1].runs);
+      }
+
+      {
+        test_parallel_runner run;
+        auto calls = 0;
+        run.on(events::test<test_move_only>{
+            .type = "test",
+            .name = "move only",
+            .location = {},
+            .arg = none{},
+            .run = test_move_only{std::make_unique<int*>(&calls)}});
+        test_assert(1 == calls);
+        const auto& repeated = run.reporter_.repeated_.tests;
+        test_assert(1u == std::size(repeated));
+        test_assert("move only" == repeated[0].name);
+        test_assert(not repeated[0].repeatable);
+      }
+
+#if __has_include(<unistd.h>) and __has_include(<sys/wait.h>)
+      ut::detail::cfg::fork_jobs = 1;
+      {
+        test_parallel_runner run;
+        run.on(events::test<std::function<void()>>{
+            .type = "test",
+            .name = "forked",
+            .location = {},
+            .arg = none{},
+            .run = [&run] {
+              void(run.on(events::assertion<bool>{.expr = true, .location = {}}));
+            }});
+        test_assert(not run.run());  // reaps the child
+        const auto& repeated = run.reporter_.repeated_.tests;
+        test_assert(1u == std::size(repeated));
+        test_assert(10u == repeated[0].runs and 0u == repeated[0].fails);
+        test_assert(1 == run.reporter_.asserts_.pass);
+      }
+      ut::detail::cfg::fork_jobs = 0;
+#endif
+
+      ut::detail::cfg::repeat = 1;
+      ut::detail::cfg::jobs = 1;
+      ut::detail::cfg::until_fail = true;
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());
+        auto calls = 0;
+        run.on(events::test<std::function<void()>>{
+            .type = "test",
+            .name = "fails at last",
+            .location = {},
+            .arg = none{},
+            .run = [&] {
+              void(run.on(
+                  events::assertion<bool>{.expr = ++calls < 5, .location = {}}));
+            }});
+        test_assert(5 == calls);
+        test_assert(1 == run.reporter_.tests_.fail);
+        test_assert(5u == run.reporter_.repeated_.tests[0].runs);
+        test_assert(1u == run.reporter_.repeated_.tests[0].fails);
+      }
+      ut::detail::cfg::until_fail = false;
+    }
+
+    {
+      ut::detail::cfg::cache_dir = "ut_cache";
+      ut::detail::cfg::cache_key = "ut_test";
+      std::stringstream cache_file{};
+      cache_file << "ut_cache/ut-" << std::hex << ut::detail::fnv1a("ut_test")
+                 << ".cache";
+      std::remove(cache_file.str().c_str());  // of an interrupted run
+      const auto test = [](test_parallel_runner& run, const char* name,
+                           const bool result) {
+        run.on(events::test<std::function<void()>>{
+            .type = "test",
+            .name = name,
+            .location = {},
+            .arg = none{},
+            .run = [&run, result] {
+              void(run.on(events::assertion<bool>{.expr = result, .location = {}}));
+            }});
+      };
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());  // loads the (empty) cache
+        test(run, "passes", true);
+        test(run, "fails", false);
+        test(run, "fixed", false);
+        run.cache_->save();
+      }
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());
+        test_assert(nullptr == run.cache_->find("global", "unknown"));
+        test_assert(not run.cache_->find("global", "passes")->failed);
+        test_assert(run.cache_->find("global", "fails")->failed);
+        test_assert(run.cache_->find("global", "fails")->duration_ns > 0);
+        ut::detail::cfg::only_failed = true;
+        test(run, "passes", true);
+        test(run, "fails", false);
+        test(run, "fixed", true);
+        test(run, "new", true);
+        ut::detail::cfg::only_failed = false;
+        test_assert((std::vector<std::string>{"fails", "fixed", "new"} ==
+                     run.reporter_.names));
+        run.cache_->save();
+      }
+      {
+        test_parallel_runner run;
+        ut::detail::cfg::failed_first = true;
+        suite_body = [&] {
+          test(run, "new", true);
+          test(run, "passes", true);
+          test(run, "fixed", true);
+          test_assert(std::empty(run.reporter_.names));  // planned
+          test(run, "fails", false);
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "global"});
+        test_assert(run.run());
+        ut::detail::cfg::failed_first = false;
+        test_assert((std::vector<std::string>{"fails", "new", "passes", "fixed"} ==
+                     run.reporter_.names));
+        test_assert(not run.cache_->find("global", "fixed")->failed);
+      }
+      test_assert(0 == std::remove(cache_file.str().c_str()));
+      std::remove("ut_cache");
+      ut::detail::cfg::cache_key = "";
+      ut::detail::cfg::cache_dir = "";
+    }
+
+    {
+      {
+        std::ofstream junit{"ut_durations.xml"};
+        junit << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n"
+                 "<testsuite classname=\"ut\" name=\"global\" time=\"10\">\n"
+                 " <testcase classname=\"global\" name=\"a\" time=\"4.0\">\n"
+                 "   <testcase classname=\"global\" name=\"d\" time=\"3.5\" />\n"
+                 " </testcase>\n"
+                 " <testcase classname=\"global\" name=\"b\" time=\"3\" />\n"
+                 " <testcase name=\"c\" classname=\"global\" time=\"2\" />\n"
+                 " <testcase classname=\"global\" name=\"d\" time=\"1\" />\n"
+                 " <testcase classname=\"s\" name=\"x &amp; y\" time=\"0.5\" />\n"
+                 "</testsuite>\n</testsuites>";
+      }
+      const ut::detail::duration_history junit{"ut_durations.xml", 2};
+      test_assert(4'000'000'000 == junit.duration_ns("global", "a"));
+      test_assert(1'000'000'000 == junit.duration_ns("global", "d"));
+      test_assert(500'000'000 == junit.duration_ns("s", "x & y"));
+      test_assert(10'000'000'000 == junit.duration_ns("global"));
+      test_assert(0 == junit.duration_ns("global", "unknown"));
+      test_assert(0u == junit.shard("global", "a"));  // 4 | 0
+      test_assert(1u == junit.shard("global", "b"));  // 4 | 3
+      test_assert(1u == junit.shard("global", "c"));  // 4 | 5
+      test_assert(0u == junit.shard("global", "d"));  // 5 | 5
+      test_assert(not junit.shard("global", "unknown"));
+
+      using ut::detail::clock;
+      ut::detail::recording recording{};
+      const auto at = [](const int ms) {
+        clock::replayed = clock::time_point{std::chrono::milliseconds{ms}};
+      };
+      at(0), recording.on(events::suite_begin{.type = "suite", .name = "s"});
+      at(1), recording.on(events::test_begin{.type = "test", .name = "t"});
+      at(2), recording.on(events::test_run{.type = "test", .name = "nested"});
+      at(3), recording.on(events::test_finish{.type = "test", .name = "nested"});
+      at(5), recording.on(events::test_end{.type = "test", .name = "t"});
+      at(6), recording.on(events::suite_end{.type = "suite", .name = "s"});
+      clock::replayed.reset();
+      {
+        std::ofstream binlog{"ut_durations.binlog", std::ios::binary};
+        binlog << recording.data();
+      }
+      const ut::detail::duration_history binlog{"ut_durations.binlog", 1};
+      test_assert(4'000'000 == binlog.duration_ns("s", "t"));
+      test_assert(0 == binlog.duration_ns("s", "nested"));
+      test_assert(0u == binlog.shard("s", "t"));
+
+      ut::detail::cfg::durations_from = "ut_durations.xml";
+      ut::detail::cfg::shard_count = 2;
+      {
+        test_parallel_runner run;
+        test_assert(not run.run());
+        for (const auto* name : {"a", "b", "c", "d", "new"}) {
+          run.on(events::test<void (*)()>{.type = "test",
+                                          .name = name,
+                                          .location = {},
+                                          .arg = none{},
+                                          .run = [] {}});
+        }
+        test_assert((std::vector<std::string>{"a", "d", "new"} ==
+                     run.reporter_.names));
+      }
+      ut::detail::cfg::shard_count = 0;
+      ut::detail::cfg::durations_from = "";
+      std::remove("ut_durations.xml");
+      std::remove("ut_durations.binlog");
+    }
+
+    {
+      ut::detail::cfg::input_filename = "ut_input_file.txt";
+      {
+        std::ofstream file{ut::detail::cfg::input_filename};
+        file << "# impacted tests\nb\r\n\nd\nb\nnot declared";
+      }
+      const ut::detail::name_set names{ut::detail::cfg::input_filename};
+      test_assert(3u == names.size());
+      test_assert(names.contains("b") and names.contains("d") and
+                  names.contains("not declared"));
+      test_assert(not names.contains("a") and not names.contains("") and
+                  not names.contains("# impacted tests"));
+
+      test_parallel_runner run;
+      test_assert(not run.run());  // loads the file
+      for (const auto* name : {"a", "b", "c", "d"}) {
+        run.on(events::test<void (*)()>{.type = "test",
+                                        .name = name,
+                                        .location = {},
+                                        .arg = none{},
+                                        .run = [] {}});
+      }
+      test_assert((std::vector<std::string>{"b", "d"} == run.reporter_.names));
+      std::remove(ut::detail::cfg::input_filename.c_str());
+      ut::detail::cfg::input_filename = "";
+    }
+
+    {
+      test_parallel_runner run;
+      run.tags_.filter({"fast*", "db"});
+      const auto test = [&](std::string name,
+                            std::vector<std::string_view> tag) {
+        run.on(events::test<void (*)()>{.type = "test",
+                                        .name = std::move(name),
+                                        .tag = std::move(tag),
+                                        .location = {},
+                                        .arg = none{},
+                                        .run = [] {}});
+      };
+
+      test("untagged", {});
+      test("fast", {"fast_io"});
+      test("slow", {"slow"});
+      test("db", {"slow", "db"});
+      test("skipped", {"fast", "skip"});
+      test("serial", {"serial"});
+      test("serial slow", {"serial", "slow"});
+      test_assert((std::vector<std::string>{"untagged", "fast", "db",
+                                            "serial"} == run.reporter_.names));
+
+      std::stringstream out{};
+      auto* old_cout = std::cout.rdbuf(out.rdbuf());
+      ut::detail::cfg::list_tags = true;
+      test("listed", {"slow", "db"});
+      test("listed", {"fast", "db"});
+      test_assert(not run.run());
+      ut::detail::cfg::list_tags = false;
+      std::cout.rdbuf(old_cout);
+      test_assert("tag: db\ntag: fast\ntag: slow\n" == out.str());
+    }
+
+    {
+      ut::detail::cfg::use_reporter = "junit";
+      ut::detail::cfg::stream_junit = true;
+      ut::detail::cfg::output_filename = "ut_junit_stream.xml";
+      const auto read = [] {
+        std::ifstream file{ut::detail::cfg::output_filename};
+        return std::string{std::istreambuf_iterator<char>{file}, {}};
+      };
+      {
+        ut::reporter_junit<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+        reporter.on(events::test_begin{.type = "test", .name = "t"});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::test_end{.type = "test", .name = "t"});
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        test_assert(read().find("<testsuite classname=") != std::string::npos);
+        test_assert(read().find("</testsuites>") == std::string::npos);
+        reporter.on(events::summary{});
+      }
+      const auto xml = read();
+      test_assert(xml.starts_with(
+          "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<testsuites name=\"all\" tests=\"1\" failures=\"0\" time=\"0.0"));
+      test_assert(xml.find(" name=\"s\" tests=\"1\" ") != std::string::npos);
+      test_assert(xml.find(" name=\"global\" tests=\"0\" ") !=
+                  std::string::npos);
+      test_assert(xml.ends_with("</testsuite>\n</testsuites>"));
+      std::remove(ut::detail::cfg::output_filename.c_str());
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::stream_junit = false;
+      ut::detail::cfg::use_reporter = "console";
+    }
+
+    {
+      ut::detail::cfg::output_filename = "ut_events.binlog";
+      {
+        ut::reporter_binlog<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+        reporter.on(events::test_begin{.type = "test", .name = "t1"});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::assertion_fail<bool>{.expr = false, .location = {}});
+        reporter.on(events::log<std::string_view>{.msg = "msg"});
+        reporter.on(events::test_end{.type = "test", .name = "t1"});
+        reporter.on(events::test_begin{.type = "test", .name = "t2"});
+        reporter.on(events::exception{.msg = "what"});
+        reporter.on(events::test_end{.type = "test", .name = "t2"});
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        reporter.on(events::summary{});
+      }
+      ut::detail::cfg::output_filename = "";
+
+      const ut::detail::mapped_file binlog{"ut_events.binlog"};
+      test_assert(not std::empty(binlog.data()));
+      test_assert(2 == ut::detail::recording::scan(binlog.data()).fails);
+      test_assert(0 == ut::detail::recording::scan(binlog.data()).depth);
+
+      test_ordered_reporter replayed{};
+      ut::detail::recording::replay(binlog.data(), replayed);
+      test_assert((std::vector<std::string>{"t1", "t2"} == replayed.names));
+      test_assert(2 == replayed.asserts_.pass);
+      test_assert(2 == replayed.asserts_.fail);  // + exception
+
+      // shards are merged by concatenating their files
+      const auto merged = std::string{binlog.data()} + std::string{binlog.data()};
+      test_assert(4 == ut::detail::recording::scan(merged).fails);
+      test_ordered_reporter merged_replay{};
+      ut::detail::recording::replay(merged, merged_replay);
+      test_assert(4 == std::size(merged_replay.names));
+      std::remove("ut_events.binlog");
+    }
+
+    {
+      std::stringstream out{};
+      {
+        ut::reporter_jsonl<printer> reporter{out};
+        reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+        reporter.on(events::test_begin{.type = "test", .name = "t"});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::test_run{.type = "test", .name = "n"});
+        reporter.on(events::assertions_passed{.count = 2});
+        reporter.on(events::assertion_fail<std::string_view>{
+            .expr = "\"a\"\n", .location = {}});
+        reporter.on(events::test_finish{.type = "test", .name = "n"});
+        test_assert(out.str().ends_with("\"assertions_failed\":1}\n"));  // live
+        reporter.on(events::log<std::string_view>{.msg = "\x01"});
+        reporter.on(events::test_end{.type = "test", .name = "t"});
+        reporter.on(events::test_skip{.type = "test", .name = "k"});
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        reporter.on(events::summary{});
+      }
+
+      std::vector<std::string> lines{};
+      for (std::string line{}; std::getline(out, line);) {
+        lines.push_back(line);
+      }
+      test_assert(10 == std::size(lines));
+      test_assert(lines[0].starts_with(
+          "{\"event\":\"suite_begin\",\"ts\":"));
+      test_assert(lines[0].ends_with(",\"path\":[\"s\"]}"));
+      test_assert(lines[1].starts_with("{\"event\":\"test_begin\""));
+      test_assert(lines[1].find(",\"path\":[\"s\",\"t\"],\"file\":") !=
+                  std::string::npos);
+      test_assert(lines[2].find(",\"path\":[\"s\",\"t\",\"n\"]") !=
+                  std::string::npos);
+      test_assert(lines[3].starts_with("{\"event\":\"assertion_fail\""));
+      test_assert(lines[3].ends_with(",\"expr\":\"\\\"a\\\"\\n\"}"));
+      test_assert(lines[4].starts_with("{\"event\":\"test_finish\""));
+      test_assert(lines[4].find(",\"duration_ns\":") != std::string::npos);
+      test_assert(lines[4].ends_with(
+          ",\"assertions_passed\":2,\"assertions_failed\":1}"));
+      test_assert(lines[5].ends_with(",\"path\":[\"s\",\"t\"],\"msg\":\"\\u0001\"}"));
+      test_assert(lines[6].starts_with("{\"event\":\"test_end\""));
+      test_assert(lines[6].ends_with(
+          ",\"assertions_passed\":3,\"assertions_failed\":1}"));
+      test_assert(lines[7].starts_with("{\"event\":\"test_skip\""));
+      test_assert(lines[7].ends_with(",\"path\":[\"s\",\"k\"]}"));
+      test_assert(lines[9].starts_with("{\"event\":\"summary\""));
+      test_assert(lines[9].ends_with(
+          ",\"path\":[],\"tests\":1,\"failed\":1,\"skipped\":1,"
+          "\"assertions_passed\":3,\"assertions_failed\":1}"));
+    }
+
+    {
+      std::stringstream out{};
+      ut::reporter_tap<printer> reporter{out};
+      reporter.on(events::test_begin{.type = "test", .name = "top"});
+      reporter.on(events::test_end{.type = "test", .name = "top"});
+      reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+      reporter.on(events::test_begin{.type = "test", .name = "t"});
+      reporter.on(events::test_run{.type = "test", .name = "n"});
+      reporter.on(events::log<std::string_view>{.msg = "partial "});
+      reporter.on(events::log<std::string_view>{.msg = "line\nrest"});
+      reporter.on(events::assertion_fail<std::string_view>{
+          .expr = "1 == \"2\"", .location = {}});
+      reporter.on(events::test_finish{.type = "test", .name = "n"});
+      test_assert(out.str().ends_with("  ...\n"));  // flushed when known
+      reporter.on(events::test_run{.type = "test", .name = "m"});
+      reporter.on(events::test_finish{.type = "test", .name = "m"});
+      reporter.on(events::test_end{.type = "test", .name = "t"});
+      reporter.on(events::test_skip{.type = "test", .name = "k"});
+      reporter.on(events::suite_end{.type = "suite", .name = "s"});
+      reporter.on(events::summary{});
+
+      const auto file = std::string{reflection::source_location{}.file_name()};
+      test_assert(out.str() ==
+                  "TAP version 14\n"
+                  "ok 1 - top\n"
+                  "# Subtest: s\n"
+                  "    # Subtest: t\n"
+                  "        # partial line\n"
+                  "        # rest\n"
+                  "        not ok 1 - n\n"
+                  "          ---\n"
+                  "          - at:\n"
+                  "              file: \"" + file + "\"\n"
+                  "              line: 0\n"
+                  "            expr: \"1 == \\\"2\\\"\"\n"
+                  "          ...\n"
+                  "        ok 2 - m\n"
+                  "        1..2\n"
+                  "    not ok 1 - t\n"
+                  "    ok 2 - k # SKIP\n"
+                  "    1..2\n"
+                  "not ok 2 - s\n"
+                  "1..2\n");
+    }
+
+    {
+      const auto run_suite = [](auto& run) {
+        suite_body = [&] {
+          run.on(events::test<std::function<void()>>{
+              .type = "test",
+              .name = "pass",
+              .location = {},
+              .arg = none{},
+              .run = [&] {
+                void(run.on(
+                    events::assertion<bool>{.expr = true, .location = {}}));
+              }});
+          run.on(events::test<std::function<void()>>{
+              .type = "test",
+              .name = "fail",
+              .location = {},
+              .arg = none{},
+              .run = [&] {
+                void(run.on(
+                    events::assertion<bool>{.expr = false, .location = {}}));
+              }});
+        };
+        run.on(events::suite<void (*)()>{.run = test_suite, .name = "s"});
+        return run.run();
+      };
+      const auto read = [](const std::string& filename) {
+        std::ifstream file{filename};
+        auto text = std::string{std::istreambuf_iterator<char>{file}, {}};
+        file.close();
+        std::remove(filename.c_str());
+        return text;
+      };
+
+      ut::detail::cfg::output_filename = "ut_runner.binlog";
+      {
+        ut::runner<ut::reporter_binlog<printer>> run{};
+        test_assert(run_suite(run));
+      }
+      const auto binlog = read(ut::detail::cfg::output_filename);
+      test_assert(1 == ut::detail::recording::scan(binlog).fails);
+      test_ordered_reporter replayed{};
+      ut::detail::recording::replay(binlog, replayed);
+      test_assert((std::vector<std::string>{"pass", "fail"} == replayed.names));
+
+      ut::detail::cfg::output_filename = "ut_runner.jsonl";
+      {
+        ut::runner<ut::reporter_jsonl<printer>> run{};
+        test_assert(run_suite(run));
+      }
+      const auto jsonl = read(ut::detail::cfg::output_filename);
+      test_assert(jsonl.starts_with("{\"event\":\"run_begin\""));
+      test_assert(jsonl.ends_with(
+          ",\"tests\":2,\"failed\":1,\"skipped\":0,"
+          "\"assertions_passed\":1,\"assertions_failed\":1}\n"));
+
+      ut::detail::cfg::output_filename = "ut_runner.tap";
+      {
+        ut::runner<ut::reporter_tap<printer>> run{};
+        test_assert(run_suite(run));
+      }
+      const auto tap = read(ut::detail::cfg::output_filename);
+      test_assert(tap.starts_with("TAP version 14\n# Subtest: s\n"));
+      test_assert(tap.find("    ok 1 - pass\n    not ok 2 - fail\n") !=
+                  std::string::npos);
+      test_assert(tap.ends_with("not ok 1 - s\n1..1\n"));
+
+      // --reporter picks the reporter at the beginning of the run
+      ut::detail::cfg::use_reporter = "junit";
+      ut::detail::cfg::output_filename = "ut_selected.xml";
+      {
+        ut::runner<ut::reporter_select<ut::reporter_junit<printer>,
+                                       ut::reporter_binlog<printer>>>
+            run{};
+        test_assert(run_suite(run));
+      }
+      const auto xml = read(ut::detail::cfg::output_filename);
+      test_assert(xml.starts_with("<?xml"));
+      test_assert(xml.find("<testcase classname=\"s\" name=\"fail\"") !=
+                  std::string::npos);
+
+      // the summary is reported once per runner type
+      using selected = ut::reporter_select<
+          ut::reporter_junit<printer>, ut::reporter_jsonl<printer>,
+          ut::reporter_tap<printer>, ut::reporter_binlog<printer>>;
+      ut::detail::cfg::use_reporter = "tap";
+      ut::detail::cfg::output_filename = "ut_selected.tap";
+      {
+        ut::runner<selected> run{};
+        test_assert(run_suite(run));
+      }
+      test_assert(tap == read(ut::detail::cfg::output_filename));
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::use_reporter = "console";
+    }
+
+    {
+      const auto escaped = [](std::string_view text) {
+        std::stringstream out{};
+        out << ut::detail::xml_escaped{text};
+        return out.str();
+      };
+      test_assert(escaped("").empty());
+      test_assert("plain text" == escaped("plain text"));
+      test_assert("&lt;a href=&quot;x&quot;&gt;&amp;&apos;" ==
+                  escaped("<a href=\"x\">&'"));
+      test_assert("1 == 2" == escaped("\033[31m1 == 2\033[0m"));
+      test_assert("a\tb\nc" == escaped("a\tb\nc\001\033"));
+      test_assert("x" == escaped("x\033[1;3"));
+    }
+
+    {
+      ut::detail::cfg::use_reporter = "junit";
+      ut::detail::cfg::output_filename = "ut_junit_escape.xml";
+      {
+        ut::reporter_junit<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{.type = "suite", .name = "<s>"});
+        reporter.on(events::test_begin{.type = "test", .name = "a & b"});
+        reporter.on(events::assertion_fail<std::string_view>{
+            .expr = "\033[31m1 < 2\033[0m", .location = {}});
+        reporter.on(events::test_end{.type = "test", .name = "a & b"});
+        reporter.on(events::suite_end{.type = "suite", .name = "<s>"});
+        reporter.on(events::summary{});
+      }
+      std::ifstream file{ut::detail::cfg::output_filename};
+      const auto xml = std::string{std::istreambuf_iterator<char>{file}, {}};
+      file.close();
+      test_assert(xml.find(" name=\"&lt;s&gt;\"") != std::string::npos);
+      test_assert(xml.find(" name=\"a &amp; b\"") != std::string::npos);
+      test_assert(xml.find("status=\"FAILED\"") != std::string::npos);
+      test_assert(xml.find("test condition: [1 &lt; 2]") != std::string::npos);
+      test_assert(xml.find('\033') == std::string::npos);
+      std::remove(ut::detail::cfg::output_filename.c_str());
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::use_reporter = "console";
+    }
+
+    {
+      ut::detail::cfg::use_reporter = "junit";
+      ut::detail::cfg::output_filename = "ut_junit_status.xml";
+      {
+        ut::reporter_junit<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+        reporter.on(events::test_begin{.type = "test", .name = "passed"});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::test_end{.type = "test", .name = "passed"});
+        reporter.on(events::test_begin{.type = "test", .name = "failed"});
+        reporter.on(
+            events::assertion_fail<bool>{.expr = false, .location = {}});
+        reporter.on(events::test_end{.type = "test", .name = "failed"});
+        reporter.on(events::test_skip{.type = "test", .name = "skipped"});
+        reporter.on(events::test_begin{.type = "test", .name = "outer"});
+        reporter.on(events::test_run{.type = "test", .name = "inner"});
+        reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+        reporter.on(events::test_finish{.type = "test", .name = "inner"});
+        reporter.on(events::test_end{.type = "test", .name = "outer"});
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        reporter.on(events::summary{});
+      }
+      std::ifstream file{ut::detail::cfg::output_filename};
+      const auto xml = std::string{std::istreambuf_iterator<char>{file}, {}};
+      file.close();
+      const auto testcase = [&](std::string_view name) {
+        const auto begin = xml.find("<testcase classname=\"s\" name=\"" +
+                                    std::string{name} + '\"');
+        test_assert(begin != std::string::npos);
+        return xml.substr(begin, xml.find('\n', begin) - begin);
+      };
+      test_assert(testcase("passed").ends_with("status=\"PASSED\" />"));
+      test_assert(testcase("failed").find("status=\"FAILED\"") !=
+                  std::string::npos);
+      test_assert(testcase("skipped").ends_with("status=\"SKIPPED\" />"));
+      test_assert(testcase("outer").ends_with("\">"));
+      test_assert(testcase("inner").ends_with(" />"));
+      test_assert(xml.find("</testcase>", xml.find("name=\"inner\"")) !=
+                  std::string::npos);
+      std::remove(ut::detail::cfg::output_filename.c_str());
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::use_reporter = "console";
+    }
+
+    {
+      ut::detail::cfg::use_reporter = "junit";
+      ut::detail::cfg::output_filename = "ut_junit_arena.xml";
+      {
+        ut::reporter_junit<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{
+            .type = "suite", .name = std::string{"suite with a long name"}});
+        for (auto i = 0; i < 1'000; ++i) {  // outgrows the initial buffer
+          const auto name = "test number " + std::to_string(i);
+          reporter.on(events::test_begin{.type = "test", .name = name});
+          reporter.on(events::test_run{.type = "test", .name = name + "/n"});
+          reporter.on(events::assertion_fail<bool>{.expr = false, .location = {}});
+          reporter.on(events::test_finish{.type = "test", .name = name + "/n"});
+          reporter.on(events::test_end{.type = "test", .name = name});
+        }
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        reporter.on(events::summary{});
+      }
+      std::ifstream file{ut::detail::cfg::output_filename};
+      const auto xml = std::string{std::istreambuf_iterator<char>{file}, {}};
+      file.close();
+      test_assert(xml.find(" name=\"suite with a long name\" tests=\"1000\" ") !=
+                  std::string::npos);
+      test_assert(xml.find(" name=\"test number 0\" ") != std::string::npos);
+      test_assert(xml.find(" name=\"test number 999/n\" ") != std::string::npos);
+      test_assert(xml.find("test condition: [false]") != std::string::npos);
+      std::remove(ut::detail::cfg::output_filename.c_str());
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::use_reporter = "console";
+    }
+
+    {
+      using std::chrono::nanoseconds;
+      ut::detail::duration_histogram durations{};
+      test_assert(nanoseconds{} == durations.percentile(.5));
+      for (auto i = 1; i <= 100; ++i) {
+        durations.add(nanoseconds{i * 1'000});
+      }
+      test_assert(100u == durations.count());
+      const auto near = [](const nanoseconds value, const std::int64_t ns) {
+        return value.count() >= ns - ns / 8 and value.count() <= ns + ns / 8;
+      };
+      test_assert(near(durations.percentile(.50), 50'000));
+      test_assert(near(durations.percentile(.90), 90'000));
+      test_assert(near(durations.percentile(.99), 99'000));
+      durations.add(nanoseconds{3});
+      test_assert(nanoseconds{3} == durations.percentile(0));
+
+      std::stringstream seconds{};
+      seconds << ut::detail::fixed_seconds{nanoseconds{1'234'567'890}} << ' '
+              << ut::detail::fixed_seconds{nanoseconds{1'500}};
+      test_assert("1.234568 0.000002" == seconds.str());
+    }
+
+    {
+      ut::detail::cfg::show_duration = true;
+      ut::detail::cfg::slowest_tests = 2;
+      ut::detail::cfg::output_filename = "ut_durations.txt";
+      std::stringstream out{};
+      auto* old_cout = std::cout.rdbuf(out.rdbuf());
+      {
+        ut::reporter_junit<printer> reporter{};
+        reporter.on(events::run_begin{});
+        reporter.on(events::suite_begin{.type = "suite", .name = "s"});
+        for (const auto* name : {"a", "b", "c"}) {
+          reporter.on(events::test_begin{.type = "test", .name = name});
+          reporter.on(events::assertion_pass<bool>{.expr = true, .location = {}});
+          reporter.on(events::test_end{.type = "test", .name = name});
+        }
+        reporter.on(events::suite_end{.type = "suite", .name = "s"});
+        reporter.on(events::summary{});
+      }
+      std::cout.rdbuf(old_cout);
+      std::ifstream file{ut::detail::cfg::output_filename};
+      const auto summary = std::string{std::istreambuf_iterator<char>{file}, {}};
+      file.close();
+      test_assert(summary.find("\n\nSlowest 2 tests:\n  0.") != std::string::npos);
+      test_assert(summary.find("s  s \"") != std::string::npos);
+      test_assert(summary.find("\n\nDurations per suite (p50 | p90 | p99):\n  s: 0.") !=
+                  std::string::npos);
+      test_assert(summary.ends_with("s (3 tests)\n"));
+      std::remove(ut::detail::cfg::output_filename.c_str());
+      ut::detail::cfg::output_filename = "";
+      ut::detail::cfg::slowest_tests = 10;
+      ut::detail::cfg::show_duration = false;
+    }
+
     auto& test_cfg = ut::cfg<ut::override>;
 
     {